@@ -29,6 +29,209 @@
 # define SIZETSIZE	ALGN(sizeof(size_t), STRUCT_AL)
 
 
+# define ARENA_HUGE	(2 * 1024 * 1024)	/* huge page size */
+# define ARENA_PAGE	65536			/* release unit for small pages */
+# define ARENA_RANGES	8			/* initial # free ranges */
+
+/*
+ * large regions of memory mapped from the host, from which the static and
+ * dynamic chunks are taken if arena_size is configured
+ */
+class Arena {
+public:
+    /*
+     * initialize arenas
+     */
+    static void init(size_t size, int huge) {
+	asize = ALGN(size, ARENA_HUGE);
+	ahuge = huge;
+    }
+
+    /*
+     * allocate memory from an arena, or return NULL if arenas are not used
+     */
+    static char *alloc(size_t size) {
+	Arena *a;
+	char *mem;
+
+	if (asize == 0) {
+	    return (char *) NULL;
+	}
+
+	size = ALGN(size, STRUCT_AL);
+	for (a = alist; a != (Arena *) NULL; a = a->next) {
+	    mem = a->take(size);
+	    if (mem != (char *) NULL) {
+		return mem;
+	    }
+	}
+
+	/* map a new arena */
+	a = (Arena *) malloc(sizeof(Arena));
+	if (a == (Arena *) NULL) {
+	    fatal("out of memory");
+	}
+	a->size = (size > asize) ? ALGN(size, ARENA_HUGE) : asize;
+	a->base = (char *) P_mmap(a->size, ahuge);
+	a->ranges = (Range *) malloc(sizeof(Range) * ARENA_RANGES);
+	if (a->base == (char *) NULL || a->ranges == (Range *) NULL) {
+	    fatal("out of memory");
+	}
+	a->ranges[0].mem = a->base;
+	a->ranges[0].size = a->size;
+	a->nranges = 1;
+	a->rsize = ARENA_RANGES;
+	a->next = alist;
+	alist = a;
+
+	return a->take(size);
+    }
+
+    /*
+     * return memory to the arena it was taken from, if any
+     */
+    static bool free(char *mem, size_t size) {
+	Arena *a;
+
+	for (a = alist; a != (Arena *) NULL; a = a->next) {
+	    if (mem >= a->base && mem < a->base + a->size) {
+		a->give(mem, ALGN(size, STRUCT_AL));
+		return TRUE;
+	    }
+	}
+	return FALSE;
+    }
+
+    /*
+     * return the pages of free arena memory to the host
+     */
+    static void release() {
+	Arena *a;
+	Range *r;
+	unsigned int i;
+	uintptr_t page, start, end;
+
+	page = (ahuge != 0) ? ARENA_HUGE : ARENA_PAGE;
+	for (a = alist; a != (Arena *) NULL; a = a->next) {
+	    for (i = a->nranges, r = a->ranges; i != 0; --i, r++) {
+		start = ALGN((uintptr_t) r->mem, page);
+		end = ((uintptr_t) r->mem + r->size) & ~(page - 1);
+		if (start < end) {
+		    P_mrelease((void *) start, end - start);
+		}
+	    }
+	}
+    }
+
+    /*
+     * unmap all arenas
+     */
+    static void finish() {
+	Arena *a;
+
+	while (alist != (Arena *) NULL) {
+	    a = alist;
+	    alist = a->next;
+	    P_munmap(a->base, a->size);
+	    std::free(a->ranges);
+	    std::free(a);
+	}
+	asize = 0;
+    }
+
+private:
+    struct Range {
+	char *mem;			/* start of free range */
+	size_t size;			/* size of free range */
+    };
+
+    /*
+     * take memory from the first free range large enough
+     */
+    char *take(size_t size) {
+	Range *r;
+	unsigned int i;
+	char *mem;
+
+	for (i = 0, r = ranges; i < nranges; i++, r++) {
+	    if (r->size >= size) {
+		mem = r->mem;
+		r->mem += size;
+		r->size -= size;
+		if (r->size == 0) {
+		    memmove(r, r + 1, (--nranges - i) * sizeof(Range));
+		}
+		return mem;
+	    }
+	}
+	return (char *) NULL;
+    }
+
+    /*
+     * give memory back, merging it with adjacent free ranges
+     */
+    void give(char *mem, size_t size) {
+	Range *r;
+	unsigned int l, h, m;
+
+	/* find the first free range after mem */
+	l = 0;
+	h = nranges;
+	while (l < h) {
+	    m = (l + h) >> 1;
+	    if (ranges[m].mem < mem) {
+		l = m + 1;
+	    } else {
+		h = m;
+	    }
+	}
+
+	if (l != 0 && ranges[l - 1].mem + ranges[l - 1].size == mem) {
+	    /* merge with previous range */
+	    r = &ranges[l - 1];
+	    r->size += size;
+	    if (l < nranges && mem + size == ranges[l].mem) {
+		r->size += ranges[l].size;
+		memmove(r + 1, r + 2, (--nranges - l) * sizeof(Range));
+	    }
+	} else if (l < nranges && mem + size == ranges[l].mem) {
+	    /* merge with next range */
+	    ranges[l].mem = mem;
+	    ranges[l].size += size;
+	} else {
+	    /* new range */
+	    if (nranges == rsize) {
+		r = (Range *) realloc(ranges, sizeof(Range) * (rsize <<= 1));
+		if (r == (Range *) NULL) {
+		    fatal("out of memory");
+		}
+		ranges = r;
+	    }
+	    r = &ranges[l];
+	    memmove(r + 1, r, (nranges++ - l) * sizeof(Range));
+	    r->mem = mem;
+	    r->size = size;
+	}
+    }
+
+    char *base;				/* start of arena */
+    size_t size;			/* size of arena */
+    Range *ranges;			/* free ranges, by address */
+    unsigned int nranges;		/* # free ranges */
+    unsigned int rsize;			/* # free ranges allocated */
+    Arena *next;			/* next arena */
+
+    static Arena *alist;		/* list of arenas */
+    static size_t asize;		/* arena size, or 0 */
+    static int ahuge;			/* huge pages: 0 none, 1 transparent,
+					   2 explicit */
+};
+
+Arena *Arena::alist;
+size_t Arena::asize;
+int Arena::ahuge;
+
+
 class MemChunk {
 public:
     /*
@@ -38,17 +241,24 @@ public:
 	MemChunk *mem;
 
 	if (list != (MemChunk **) NULL) {
-	    size += ALGN(sizeof(MemChunk *), STRUCT_AL);
+	    /* chunk with header, from an arena if possible */
+	    size += ALGN(sizeof(MemChunk), STRUCT_AL);
+	    mem = (MemChunk *) Arena::alloc(size);
+	    if (mem == (MemChunk *) NULL) {
+		mem = (MemChunk *) malloc(size);
+	    }
+	} else {
+	    mem = (MemChunk *) malloc(size);
 	}
-	mem = (MemChunk *) malloc(size);
 	if (mem == (MemChunk *) NULL) {
 	    fatal("out of memory");
 	}
 	if (list != (MemChunk **) NULL) {
-	    *((MemChunk **) mem) = *list;
+	    mem->size = size;
+	    mem->next = *list;
 	    *list = mem;
 	    mem = (MemChunk *) ((char *) mem +
-				ALGN(sizeof(MemChunk *), STRUCT_AL));
+				ALGN(sizeof(MemChunk), STRUCT_AL));
 	}
 	return mem;
     }
@@ -59,8 +269,10 @@ public:
     static MemChunk *free(MemChunk *mem) {
 	MemChunk *next;
 
-	next = *(MemChunk **) mem;
-	std::free(mem);
+	next = mem->next;
+	if (!Arena::free((char *) mem, mem->size)) {
+	    std::free(mem);
+	}
 	return next;
     }
 
@@ -576,6 +788,10 @@ public:
 # define DLIMIT		(DSMALL + MOFFSET)
 # define DCHUNKS	(DSMALL / STRUCT_AL - 1)
 # define DCHUNKSZ	32768
+# define DMIN		(MOFFSET + STRUCT_AL)	/* smallest chunk */
+# define DCLASS		4096		/* largest size class */
+# define DCLIMIT	(DCLASS + MOFFSET)
+# define DCLASSES	25		/* 4 per power of 2 from DSMALL to DCLASS */
 
 class DynamicMem {
 public:
@@ -589,6 +805,7 @@ public:
 	    dlist = MemChunk::free(dlist);
 	}
 	memset(dchunks, '\0', sizeof(dchunks));
+	memset(dclasses, '\0', sizeof(dclasses));
 	dchunk = (MemChunk *) NULL;
 	dtree = (SplayNode *) NULL;
 	memSize = memUsed = 0;
@@ -616,17 +833,31 @@ public:
 	}
 	StaticMem::dmem = TRUE;
 
-	if (size < DLIMIT) {
-	    /*
-	     * small chunk
-	     */
-	    if ((c=dchunks[(size - MOFFSET) / STRUCT_AL - 1]) !=
-							    (MemChunk *) NULL) {
-		/* small chunk from free list */
-		dchunks[(size - MOFFSET) / STRUCT_AL - 1] = c->next;
+	if (size <= DCLIMIT) {
+	    MemChunk **list;
+
+	    if (size < DLIMIT) {
+		/* small chunk */
+		list = &dchunks[(size - MOFFSET) / STRUCT_AL - 1];
+	    } else {
+		unsigned int i;
+
+		/* round up to size class */
+		i = sizeClass(size);
+		size = classSize(i);
+		list = &dclasses[i];
+	    }
+	    if ((c=*list) != (MemChunk *) NULL) {
+		/* chunk from free list */
+		*list = c->next;
 		return c;
 	    }
-	    if (dchunk == (MemChunk *) NULL) {
+	    if (dchunk == (MemChunk *) NULL || dchunk->size < size) {
+		if (dchunk != (MemChunk *) NULL) {
+		    /* keep what is left for later */
+		    recycle(dchunk);
+		}
+
 		/* get new chunks chunk */
 		dchunk = alloc(DCHUNKSZ);
 		p = (char *) dchunk + SIZETSIZE;
@@ -637,8 +868,8 @@ public:
 	    sz = dchunk->size - size;
 	    c = dchunk;
 	    c->size = size;
-	    if (sz >= DLIMIT - STRUCT_AL) {
-		/* enough is left for another small chunk */
+	    if (sz >= DMIN) {
+		/* enough is left for another chunk */
 		dchunk = (MemChunk *) ((char *) c + size);
 		dchunk->size = sz;
 	    } else {
@@ -718,6 +949,12 @@ public:
 	    dchunks[(c->size - MOFFSET) / STRUCT_AL - 1] = c;
 	    return;
 	}
+	if (c->size <= DCLIMIT) {
+	    /* chunk of a size class */
+	    c->next = dclasses[sizeClass(c->size)];
+	    dclasses[sizeClass(c->size)] = c;
+	    return;
+	}
 
 	p = (char *) c - SIZETSIZE;
 	if (*(size_t *) p != 0) {
@@ -758,9 +995,65 @@ public:
 	SplayNode::insert(dtree, (SplayNode *) c);	/* add to free list */
     }
 
+private:
+    /*
+     * Size class of a chunk in the range DLIMIT to DCLIMIT, rounding up.
+     * There are 4 classes per power of 2, starting at DSMALL.
+     */
+    static unsigned int sizeClass(size_t size) {
+	unsigned int e;
+
+	size -= MOFFSET + 1;
+	if (size < DSMALL) {
+	    return 0;
+	}
+	for (e = 6; size >> (e + 1) != 0; e++) ;
+	return (e - 6) * 4 + (unsigned int) ((size >> (e - 2)) & 3) + 1;
+    }
+
+    /*
+     * chunk size of a size class
+     */
+    static size_t classSize(unsigned int i) {
+	unsigned int e;
+
+	if (i == 0) {
+	    return DLIMIT;
+	}
+	e = 6 + (i - 1) / 4;
+	return ((size_t) 1 << e) + ((size_t) ((i - 1) % 4 + 1) << (e - 2)) +
+	       MOFFSET;
+    }
+
+    /*
+     * put the remainder of a chunks chunk in the free list for the largest
+     * size that fits
+     */
+    static void recycle(MemChunk *c) {
+	unsigned int i;
+
+	if (c->size < DMIN) {
+	    return;	/* too small to use */
+	}
+	if (c->size < DLIMIT) {
+	    c->next = dchunks[(c->size - MOFFSET) / STRUCT_AL - 1];
+	    dchunks[(c->size - MOFFSET) / STRUCT_AL - 1] = c;
+	} else {
+	    i = sizeClass(c->size);
+	    if (classSize(i) > c->size) {
+		--i;
+	    }
+	    c->size = classSize(i);
+	    c->next = dclasses[i];
+	    dclasses[i] = c;
+	}
+    }
+
+public:
     static SplayNode *dtree;	/* splay tree of large dynamic free chunks */
     static MemChunk *dlist;		/* list of dynamic memory chunks */
     static MemChunk *dchunks[DCHUNKS];	/* list of free small chunks */
+    static MemChunk *dclasses[DCLASSES]; /* lists of free size class chunks */
     static MemChunk *dchunk;		/* chunk of small chunks */
     static size_t dchunksz;		/* dynamic chunk size */
     static size_t memSize;		/* dynamic memory size */
@@ -770,6 +1063,7 @@ public:
 SplayNode *DynamicMem::dtree;		/* large dynamic free chunks */
 MemChunk *DynamicMem::dlist;		/* list of dynamic memory chunks */
 MemChunk *DynamicMem::dchunks[DCHUNKS];	/* list of free small chunks */
+MemChunk *DynamicMem::dclasses[DCLASSES]; /* free size class chunks */
 MemChunk *DynamicMem::dchunk;		/* chunk of small chunks */
 size_t DynamicMem::dchunksz;		/* dynamic chunk size */
 size_t DynamicMem::memSize;		/* dynamic memory size */
@@ -781,12 +1075,16 @@ static MemHeader *hlist;	/* list of all dynamic memory chunks */
 # endif
 
 int Alloc::sLevel;
+size_t Alloc::sampleLeft = ~(size_t) 0;
+static size_t sampleBytes;		/* mean # bytes between samples */
+static void (*sampler)(size_t, void*);	/* allocation sampler */
 
 /*
  * initialize memory manager
  */
-void Alloc::init(size_t ssz, size_t dsz)
+void Alloc::init(size_t ssz, size_t dsz, size_t asz, int huge)
 {
+    Arena::init(asz, huge);
     StaticMem::init(ssz);
     DynamicMem::init(dsz);
 }
@@ -823,6 +1121,11 @@ char *Alloc::alloc(size_t size)
 	fatal("alloc(0)");
     }
 # endif
+    if (size >= sampleLeft) {
+	sampled(size, CALLSITE());
+    } else {
+	sampleLeft -= size;
+    }
     size = ALGN(size + MOFFSET, STRUCT_AL);
 # ifndef DEBUG
     if (size < ALGN(sizeof(MemChunk), STRUCT_AL)) {
@@ -912,6 +1215,11 @@ char *Alloc::realloc(char *mem, size_t size1, size_t size2)
 	free(mem);
 	return (char *) NULL;
     }
+    if (size2 >= sampleLeft) {
+	sampled(size2, CALLSITE());
+    } else {
+	sampleLeft -= size2;
+    }
 
     size2 = ALGN(size2 + MOFFSET, STRUCT_AL);
 # ifndef DEBUG
@@ -943,7 +1251,7 @@ char *Alloc::realloc(char *mem, size_t size1, size_t size2)
 	    fatal("bad size1 in m_realloc");
 	}
 # endif
-	if ((c1->size & SIZE_MASK) < ((size2 < DLIMIT) ?
+	if ((c1->size & SIZE_MASK) < ((size2 <= DCLIMIT) ?
 				       size2 : size2 + SIZETSIZE)) {
 	    c2 = DynamicMem::alloc(size2);
 	    if (size1 != 0) {
@@ -998,7 +1306,8 @@ void Alloc::purge()
 	size_t n;
 
 	n = (hlist->size & SIZE_MASK) - MOFFSET;
-	if (n >= DLIMIT) {
+	if (n > DCLIMIT - MOFFSET) {
+	    /* only chunks above the size classes have a boundary tag */
 	    n -= SIZETSIZE;
 	}
 # ifdef MEMDEBUG
@@ -1021,12 +1330,38 @@ void Alloc::purge()
 	}
 	strcat(buf, "\012");	/* LF */
 	P_message(buf);
-	MemChunk::free(hlist + 1);
+	FREE(hlist + 1);
     }
 # endif
 
     DynamicMem::purge();
     StaticMem::expand();
+    Arena::release();
+}
+
+/*
+ * call func for one allocation per the given number of bytes on average,
+ * with the bytes that the sample represents and the call site
+ */
+void Alloc::sample(size_t bytes, void (*func)(size_t, void*))
+{
+    sampleBytes = bytes;
+    sampler = func;
+    sampleLeft = (bytes != 0) ? bytes : ~(size_t) 0;
+}
+
+/*
+ * take an allocation sample, and pick a random distance to the next one so
+ * that periodic allocation patterns are not missed
+ */
+void Alloc::sampled(size_t size, void *site)
+{
+    if (sampleBytes == 0) {
+	sampleLeft = ~(size_t) 0;
+	return;
+    }
+    sampleLeft = sampleBytes / 2 + (size_t) P_random() % sampleBytes;
+    (*sampler)((size > sampleBytes) ? size : sampleBytes, site);
 }
 
 /*
@@ -1056,4 +1391,5 @@ void Alloc::finish()
 
     StaticMem::finish();
     DynamicMem::finish();
+    Arena::finish();
 }
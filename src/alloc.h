@@ -26,7 +26,8 @@ public:
 	size_t dmemused;	/* dynamic memory used */
     };
 
-    static void init(size_t staticSize, size_t dynamicSize);
+    static void init(size_t staticSize, size_t dynamicSize, size_t arenaSize,
+		     int hugePages);
     static void finish();
 
 # ifdef MEMDEBUG
@@ -66,9 +67,13 @@ public:
     static Info *info();
     static bool check();
     static void purge();
+    static void sample(size_t bytes, void (*func)(size_t, void*));
 
 private:
+    static void sampled(size_t size, void *site);
+
     static int sLevel;			/* static level */
+    static size_t sampleLeft;		/* bytes until the next sample */
 };
 
 /*
@@ -29,6 +29,7 @@
 static int cmp (cvoid*, cvoid*);
 
 # define ARR_CHUNK	128
+# define SLICE_MIN	16	/* shortest subrange to share */
 
 class ArrHash : public ChunkAllocated {
 public:
@@ -58,39 +59,64 @@ public:
     }
 } hchunk;
 
-# define MELT_CHUNK	128
+/*
+ * NAME:	hashindex()
+ * DESCRIPTION:	compute the hash value of a mapping index
+ */
+static Uint hashindex(Value *val)
+{
+    switch (val->type) {
+    case T_INT:
+	return val->number;
 
-class MapElt : public ChunkAllocated {
-public:
-    MapElt(Uint hashval, MapElt *next) {
-	this->hashval = hashval;
-	add = FALSE;
-	idx = Value::nil;
-	val = Value::nil;
-	this->next = next;
-    }
-    ~MapElt() {
-	if (add) {
-	    idx.del();
-	    val.del();
-	}
+    case T_FLOAT:
+	return VFLT_HASH(val);
+
+    case T_STRING:
+	return val->string->hash();
+
+    case T_OBJECT:
+	return val->oindex;
+
+    case T_ARRAY:
+    case T_MAPPING:
+    case T_LWOBJECT:
+	return (unsigned short) ((uintptr_t) (Array *) val->array >> 3);
+
+    default:
+	return 4747;
     }
+}
 
+/*
+ * NAME:	hashslot()
+ * DESCRIPTION:	first slot to probe for a hash value: scramble it, and
+ *		scale the result to the table size
+ */
+static Uint hashslot(Uint hashval, Uint tablesize)
+{
+    hashval ^= hashval >> 16;
+    hashval *= 0x85ebca6bL;
+    hashval ^= hashval >> 13;
+    return (Uint) (((Uuint) hashval * tablesize) >> 32);
+}
+
+class MapElt {
+public:
     /*
-     * remove from a mapping
+     * release the values of a new element
      */
-    void remove(Dataspace *data, Array *m) {
+    void clear(bool add) {
 	if (add) {
-	    data->assignElt(m, &idx, &Value::nil);
-	    data->assignElt(m, &val, &Value::nil);
+	    idx.del();
+	    val.del();
 	}
-	delete this;
     }
 
     /*
      * clean destructed objects
      */
-    bool clean(Dataspace *data, Array *m) {
+    bool clean(Dataspace *data, Array *m, bool add) {
 	Value *v;
 
 	switch (idx.type) {
@@ -151,34 +177,37 @@ public:
 	return FALSE;
     }
 
-    Uint hashval;		/* hash value of index */
-    bool add;			/* new element? */
     Value idx;			/* index */
     Value val;			/* value */
-    MapElt *next;		/* next in hash table */
 };
 
-static Chunk<MapElt, MELT_CHUNK> echunk;
+# define MTABLE_SIZE	4	/* most mappings are quite small */
 
-# define MTABLE_SIZE	16	/* most mappings are quite small */
+# define ME_UNUSED	0	/* free slot */
+# define ME_COPY	1	/* copy of an element in the array part */
+# define ME_ADD		2	/* new element */
+# define ME_STATE	3	/* state mask */
 
+/*
+ * Open addressing hash table with linear probing.  Elements are stored
+ * inline.  A parallel array holds the hash value of each slot, shifted
+ * left to make room for the slot state, so that probing only touches the
+ * elements which are likely to match.  The table is at most 4/5 full, so
+ * a probe always ends at an unused slot; it grows by half its size.
+ */
 class MapHash : public ChunkAllocated {
 public:
     MapHash() {
 	size = 0;
 	sizemod = 0;
-	tablesize = MTABLE_SIZE;
-	table = ALLOC(MapElt*, tablesize);
-	memset(table, '\0', tablesize * sizeof(MapElt*));
+	alloc(MTABLE_SIZE);
     }
     ~MapHash() {
-	unsigned short i;
-	MapElt *e, *n, **t;
+	Uint i, j;
 
-	for (i = size, t = table; i > 0; t++) {
-	    for (e = *t; e != (MapElt *) NULL; e = n) {
-		n = e->next;
-		delete e;
+	for (i = size, j = 0; i > 0; j++) {
+	    if (hashes[j] != ME_UNUSED) {
+		table[j].clear((hashes[j] & ME_STATE) == ME_ADD);
 		--i;
 	    }
 	}
@@ -190,134 +219,223 @@ public:
      */
     void shallowDelete()
     {
-	unsigned short i;
-	MapElt *e, *n, **t;
+	Uint i, j;
+	MapElt *e;
 
-	for (i = size, t = table; i > 0; t++) {
-	    for (e = *t; e != (MapElt *) NULL; e = n) {
-		if (e->add) {
+	for (i = size, j = 0; i > 0; j++) {
+	    if (hashes[j] != ME_UNUSED) {
+		if ((hashes[j] & ME_STATE) == ME_ADD) {
+		    e = &table[j];
 		    if (e->idx.type == T_STRING) {
 			e->idx.string->del();
 		    }
 		    if (e->val.type == T_STRING) {
 			e->val.string->del();
 		    }
-		    e->add = FALSE;
+		    hashes[j] ^= ME_ADD ^ ME_COPY;
 		}
-		n = e->next;
-		delete e;
 		--i;
 	    }
 	}
-	size = 0;
 	delete this;
     }
 
     /*
-     * extend hashtable
+     * is this a new element?
      */
-    void grow() {
-	unsigned short i;
-	Uint j;
-	MapElt *e, *n, **t, **newTable;
-
-	tablesize <<= 1;
-	newTable = ALLOC(MapElt*, tablesize);
-	memset(newTable, '\0', tablesize * sizeof(MapElt*));
+    bool added(MapElt *e) {
+	return ((hashes[e - table] & ME_STATE) == ME_ADD);
+    }
 
-	/*
-	 * copy entries from old hashtable to new hashtable
-	 */
-	for (i = size, t = table; i > 0; t++) {
-	    for (e = *t; e != (MapElt *) NULL; e = n) {
-		n = e->next;
-		j = e->hashval % tablesize;
-		e->next = newTable[j];
-		newTable[j] = e;
-		--i;
+    /*
+     * return the next new element, searching from slot *j onward
+     */
+    MapElt *nextAdded(Uint *j) {
+	while (*j < tablesize) {
+	    if ((hashes[(*j)++] & ME_STATE) == ME_ADD) {
+		return &table[*j - 1];
 	    }
 	}
-	FREE(table);
-	table = newTable;
+	return (MapElt *) NULL;
+    }
+
+    /*
+     * memory used by this hash table
+     */
+    Uint memory() {
+	return sizeof(MapHash) + tablesize * (sizeof(MapElt) + sizeof(Uint));
     }
 
     /*
      * add MapElt
      */
-    MapElt *add(Uint hashval) {
+    MapElt *add(Uint hashval, bool add) {
 	Uint i;
 
+	if ((size + 1) * 5 > tablesize * 4) {
+	    rehash(tablesize + (tablesize >> 1));
+	}
 	size++;
-	i = hashval % tablesize;
-	return table[i] = chunknew (echunk) MapElt(hashval, table[i]);
+	hashval <<= 2;
+	for (i = slot(hashval); hashes[i] != ME_UNUSED; ) {
+	    if (++i == tablesize) {
+		i = 0;
+	    }
+	}
+	hashes[i] = hashval | ((add) ? ME_ADD : ME_COPY);
+	table[i].idx = Value::nil;
+	table[i].val = Value::nil;
+	return &table[i];
     }
 
     /*
-     * remove MapElt
+     * remove MapElt, and move up elements that follow it in the same
+     * cluster if their probe sequence passes through the freed slot
      */
-    void remove(MapElt **p, Dataspace *data, Array *m) {
-	MapElt *e;
+    void remove(MapElt *e, Dataspace *data, Array *m) {
+	Uint i, j, k;
 
-	e = *p;
-	if (e->add && --sizemod == 0) {
-	    m->hashmod = FALSE;
+	i = e - table;
+	if ((hashes[i] & ME_STATE) == ME_ADD) {
+	    if (--sizemod == 0) {
+		m->hashmod = FALSE;
+	    }
+	    data->assignElt(m, &e->idx, &Value::nil);
+	    data->assignElt(m, &e->val, &Value::nil);
 	}
-	*p = e->next;
-	e->remove(data, m);
 	--size;
+
+	j = i;
+	for (;;) {
+	    if (++j == tablesize) {
+		j = 0;
+	    }
+	    if (hashes[j] == ME_UNUSED) {
+		break;
+	    }
+	    k = slot(hashes[j] & ~ME_STATE);
+	    if ((i <= j) ? (k <= i || k > j) : (k <= i && k > j)) {
+		table[i] = table[j];
+		hashes[i] = hashes[j];
+		i = j;
+	    }
+	}
+	hashes[i] = ME_UNUSED;
     }
 
     /*
      * find MapElt in hashtable
      */
-    MapElt **search(Value *val, Uint i) {
-	MapElt **p, *e;
-
-	for (p = &table[i % tablesize];
-	     (e=*p) != (MapElt *) NULL; p = &e->next) {
-	    if (cmp(val, &e->idx) == 0 &&
-		(!T_INDEXED(val->type) || val->array == e->idx.array)) {
-		return p;
+    MapElt *search(Value *val, Uint hashval) {
+	Uint i;
+	MapElt *e;
+
+	hashval <<= 2;
+	for (i = slot(hashval); hashes[i] != ME_UNUSED; ) {
+	    if ((hashes[i] & ~ME_STATE) == hashval) {
+		e = &table[i];
+		if (cmp(val, &e->idx) == 0 &&
+		    (!T_INDEXED(val->type) || val->array == e->idx.array)) {
+		    return e;
+		}
+	    }
+	    if (++i == tablesize) {
+		i = 0;
 	    }
 	}
 
-	return (MapElt **) NULL;
+	return (MapElt *) NULL;
     }
 
     /*
      * collect MapElts from hash table
      */
-    unsigned short collect(Value *v, Array *m, Dataspace *data) {
-	unsigned short i, j;
-	MapElt *e, **p, **t;
-
-	t = table;
-	for (i = size, size = sizemod = j = 0; i > 0; ) {
-	    for (p = t++; (e=*p) != (MapElt *) NULL; --i) {
-		if (m != (Array *) NULL && e->clean(data, m)) {
-		    *p = e->next;
-		    delete e;
+    asizet collect(Value *v, Array *m, Dataspace *data) {
+	Uint i, j;
+	asizet n;
+	bool removed;
+	MapElt *e;
+
+	removed = FALSE;
+	for (i = size, j = 0, sizemod = n = 0; i > 0; j++) {
+	    if (hashes[j] != ME_UNUSED) {
+		--i;
+		e = &table[j];
+		if (m != (Array *) NULL &&
+		    e->clean(data, m, (hashes[j] & ME_STATE) == ME_ADD)) {
+		    e->clear((hashes[j] & ME_STATE) == ME_ADD);
+		    hashes[j] = ME_UNUSED;
+		    --size;
+		    removed = TRUE;
 		    continue;
 		}
 
-		if (e->add) {
-		    e->add = FALSE;
+		if ((hashes[j] & ME_STATE) == ME_ADD) {
+		    hashes[j] ^= ME_ADD ^ ME_COPY;
 		    *v++ = e->idx;
 		    *v++ = e->val;
-		    j++;
+		    n++;
 		}
-		size++;
+	    }
+	}
+	if (removed) {
+	    /* restore unbroken clusters */
+	    rehash(tablesize);
+	}
+	return n;
+    }
+
+    Uint size;			/* # elements in hash table */
+    asizet sizemod;		/* mapping size modification */
 
-		p = &e->next;
+private:
+    /*
+     * allocate an empty table
+     */
+    void alloc(Uint size) {
+	tablesize = size;
+	table = (MapElt *) ALLOC(char, size * (sizeof(MapElt) + sizeof(Uint)));
+	hashes = (Uint *) (table + size);
+	memset(hashes, ME_UNUSED, size * sizeof(Uint));
+    }
+
+    /*
+     * first slot to probe for a (shifted) hash value
+     */
+    Uint slot(Uint hashval) {
+	return hashslot(hashval, tablesize);
+    }
+
+    /*
+     * move all elements to a new table
+     */
+    void rehash(Uint newsize) {
+	Uint i, j, k;
+	MapElt *otable;
+	Uint *ohashes;
+
+	otable = table;
+	ohashes = hashes;
+	i = tablesize;
+	alloc(newsize);
+	for (j = 0; j < i; j++) {
+	    if (ohashes[j] != ME_UNUSED) {
+		k = slot(ohashes[j] & ~ME_STATE);
+		while (hashes[k] != ME_UNUSED) {
+		    if (++k == tablesize) {
+			k = 0;
+		    }
+		}
+		table[k] = otable[j];
+		hashes[k] = ohashes[j];
 	    }
 	}
-	return j;
+	FREE(otable);
     }
 
-    unsigned short size;	/* # elements in hash table */
-    unsigned short sizemod;	/* mapping size modification */
     Uint tablesize;		/* actual hash table size */
-    MapElt **table;		/* hash table */
+    MapElt *table;		/* hash table */
+    Uint *hashes;		/* hash value and state of each slot */
 };
 
 static Chunk<MapHash, ARR_CHUNK> mchunk;
@@ -326,7 +444,7 @@ static Chunk<MapHash, ARR_CHUNK> mchunk;
 
 class ArrBak : public ChunkAllocated {
 public:
-    ArrBak(Array *a, Value *elts, unsigned short size, Dataplane *plane) {
+    ArrBak(Array *a, Value *elts, asizet size, Dataplane *plane) {
 	arr = a;
 	original = elts;
 	this->size = size;
@@ -339,7 +457,7 @@ public:
     void commit() {
 	if (original != (Value *) NULL) {
 	    Value *v;
-	    unsigned short i;
+	    asizet i;
 
 	    for (v = original, i = size; i != 0; v++, --i) {
 		v->del();
@@ -353,9 +471,12 @@ public:
      * discard changes and restore backup
      */
     void discard() {
-	unsigned short i;
+	asizet i;
 	Value *v;
 
+	if (arr->nslices != 0) {
+	    arr->unshare();
+	}
 	if (arr->elts != (Value *) NULL) {
 	    for (v = arr->elts, i = arr->size; i != 0; v++, --i) {
 		v->del();
@@ -371,11 +492,14 @@ public:
 
 	arr->elts = original;
 	arr->size = size;
+	if (arr->memory != 0) {
+	    arr->charge();
+	}
 	arr->del();
     }
 
     Array *arr;			/* array backed up */
-    unsigned short size;	/* original size (of mapping) */
+    asizet size;		/* original size (of mapping) */
     Value *original;		/* original elements */
     Dataplane *plane;		/* original dataplane */
 };
@@ -450,6 +574,8 @@ static Chunk<Array, ARR_CHUNK> achunk;
 unsigned long Array::max_size;		/* max. size of array and mapping */
 Uint Array::atag;			/* current array tag */
 static ArrHash *aht[ARRMERGETABSZ];	/* array merge table */
+static Array **stab;			/* table of slices */
+static Uint nslice, stabsz;		/* # slices, table size */
 
 /*
  * initialize array handling
@@ -460,14 +586,18 @@ void Array::init(unsigned int size)
     atag = 0;
 }
 
-Array::Array(unsigned short size)
+Array::Array(asizet size)
 {
     this->size = size;
     hashmod = FALSE;
+    mapping = FALSE;
     elts = (Value *) NULL;
     refCount = 0;
     objDestrCount = 0;		/* if swapped in, check objects */
+    memory = strMemory = 0;	/* not charged to a dataspace */
     hashed = (MapHash *) NULL;	/* only used for mappings */
+    shared = (Array *) NULL;
+    nslices = 0;
 }
 
 Array::~Array()
@@ -492,7 +622,7 @@ Array *Array::create(Dataspace *data, long size)
     if (size > max_size) {
 	error("Array too large");
     }
-    a = alloc((unsigned short) size);
+    a = alloc((asizet) size);
     if (size > 0) {
 	a->elts = ALLOC(Value, size);
     }
@@ -532,6 +662,9 @@ void Array::del()
 	static Array *dlist;
 	Array *a;
 
+	if (memory != 0) {
+	    discharge();
+	}
 	prev->next = next;
 	next->prev = prev;
 	prev = (Array *) NULL;
@@ -544,10 +677,16 @@ void Array::del()
 	dlist = a = this;
 	do {
 	    Value *v;
-	    unsigned short i;
+	    asizet i;
 	    Array *list;
 
-	    if ((v=a->elts) != (Value *) NULL) {
+	    if (a->shared != (Array *) NULL) {
+		/* the elements belong to the shared array */
+		stab[a->sindex] = stab[--nslice];
+		stab[a->sindex]->sindex = a->sindex;
+		a->shared->nslices--;
+		a->shared->del();
+	    } else if ((v=a->elts) != (Value *) NULL) {
 		for (i = a->size; i > 0; --i) {
 		    (v++)->del();
 		}
@@ -573,7 +712,7 @@ void Array::freelist()
 {
     Array *a;
     Value *v;
-    unsigned short i;
+    asizet i;
 
     a = this;
     do {
@@ -605,13 +744,17 @@ void Array::freelist()
 }
 
 /*
- * free all array chunks and mapping element chunks
+ * free all array chunks and mapping hash table chunks
  */
 void Array::freeall()
 {
     achunk.clean();
-    echunk.clean();
     mchunk.clean();
+    if (stab != (Array **) NULL) {
+	FREE(stab);
+	stab = (Array **) NULL;
+	stabsz = 0;
+    }
 }
 
 /*
@@ -659,7 +802,7 @@ void Array::clear()
 void Array::backup(Backup **ac)
 {
     Value *v;
-    unsigned short i;
+    asizet i;
 
 # ifdef DEBUG
     if (hashmod) {
@@ -667,7 +810,7 @@ void Array::backup(Backup **ac)
     }
 # endif
     if (size != 0) {
-	memcpy(v = ALLOC(Value, size), elts, size * sizeof(Value));
+	memcpy((void *) (v = ALLOC(Value, size)), elts, size * sizeof(Value));
 	for (i = size; i != 0; --i) {
 	    switch (v->type) {
 	    case T_STRING:
@@ -723,20 +866,25 @@ void Array::discard(Backup **ac)
 static void copytmp(Dataspace *data, Value *v1, Array *a)
 {
     Value *v2, *o;
-    unsigned short n;
+    asizet n;
 
     v2 = Dataspace::elts(a);
     if (a->objDestrCount == Object::objDestrCount) {
 	/*
 	 * no need to check for destructed objects
 	 */
-	memcpy(v1, v2, a->size * sizeof(Value));
+	memcpy((void *) v1, v2, a->size * sizeof(Value));
     } else {
 	/*
 	 * Copy and check for destructed objects.  If destructed objects are
 	 * found, they will be replaced by nil in the original array.
 	 */
 	a->objDestrCount = Object::objDestrCount;
+	if (a->shared != (Array *) NULL) {
+	    /* a copy of the elements has no destructed objects */
+	    a->unshare();
+	    v2 = a->elts;
+	}
 	for (n = a->size; n != 0; --n) {
 	    switch (v2->type) {
 	    case T_OBJECT:
@@ -826,12 +974,12 @@ static int cmp(cvoid *cv1, cvoid *cv2)
  * NAME:	search()
  * DESCRIPTION:	search for a value in an array
  */
-static int search(Value *v1, Value *v2, unsigned short h, int step, bool place)
+static int search(Value *v1, Value *v2, asizet h, int step, bool place)
 {
-    unsigned short l, m;
+    asizet l, m;
     Int c;
     Value *v3;
-    unsigned short mask;
+    asizet mask;
 
     mask = -step;
     l = 0;
@@ -897,6 +1045,94 @@ static int search(Value *v1, Value *v2, unsigned short h, int step, bool place)
     return (place) ? l : -1;
 }
 
+# define SET_HASHED	4	/* hash, rather than sort, at least this many */
+
+/*
+ * values to test for membership: sorted if there are only a few of them,
+ * hashed otherwise
+ */
+class ValueSet {
+public:
+    ValueSet(Value *v, asizet n) {
+	Uint i, j, h;
+
+	values = v;
+	size = n;
+	if (n < SET_HASHED) {
+	    qsort(v, n, sizeof(Value), cmp);
+	    index = (Uint *) NULL;
+	    return;
+	}
+
+	/* at most half full */
+	tablesize = (Uint) n * 2;
+	index = ALLOC(Uint, tablesize * (size_t) 2);
+	hashes = index + tablesize;
+	memset(index, '\0', tablesize * sizeof(Uint));
+	for (i = 0; i < n; i++, v++) {
+	    h = hash(v);
+	    j = find(v, h);
+	    if (index[j] == 0) {
+		index[j] = i + 1;
+		hashes[j] = h;
+	    }
+	}
+    }
+
+    ~ValueSet() {
+	if (index != (Uint *) NULL) {
+	    FREE(index);
+	}
+    }
+
+    /*
+     * check whether a value is in the set
+     */
+    bool member(Value *v) {
+	if (index == (Uint *) NULL) {
+	    return (search(v, values, size, 1, FALSE) >= 0);
+	}
+	return (index[find(v, hash(v))] != 0);
+    }
+
+private:
+    /*
+     * hash a value; unlike cmp(), distinguish arrays by address
+     */
+    static Uint hash(Value *v) {
+	return (T_INDEXED(v->type)) ?
+		(Uint) ((uintptr_t) (Array *) v->array >> 3) : hashindex(v);
+    }
+
+    /*
+     * find the slot of a value, or the free slot where it should go
+     */
+    Uint find(Value *v, Uint h) {
+	Uint i;
+	Value *w;
+
+	for (i = hashslot(h, tablesize); index[i] != 0; ) {
+	    if (hashes[i] == h) {
+		w = values + index[i] - 1;
+		if (cmp(v, w) == 0 &&
+		    (!T_INDEXED(v->type) || v->array == w->array)) {
+		    break;
+		}
+	    }
+	    if (++i == tablesize) {
+		i = 0;
+	    }
+	}
+	return i;
+    }
+
+    Value *values;		/* values in the set */
+    asizet size;		/* number of values */
+    Uint tablesize;		/* hash table size */
+    Uint *index;		/* 1 + index of value in each slot, or 0 */
+    Uint *hashes;		/* hash value of each slot */
+};
+
 /*
  * subtract one array from another
  */
@@ -904,7 +1140,7 @@ Array *Array::sub(Dataspace *data, Array *a2)
 {
     Value *v1, *v2, *v3, *o;
     Array *a3;
-    unsigned short n;
+    asizet n;
 
     if (a2->size == 0) {
 	/*
@@ -924,15 +1160,15 @@ Array *Array::sub(Dataspace *data, Array *a2)
 	return a3;
     }
 
-    /* copy and sort values of subtrahend */
+    /* copy values of subtrahend */
     copytmp(data, v2 = ALLOCA(Value, a2->size), a2);
-    qsort(v2, a2->size, sizeof(Value), cmp);
+    ValueSet set(v2, a2->size);
 
     v1 = Dataspace::elts(this);
     v3 = a3->elts;
     if (objDestrCount == Object::objDestrCount) {
 	for (n = size; n > 0; --n) {
-	    if (search(v1, v2, a2->size, 1, FALSE) < 0) {
+	    if (!set.member(v1)) {
 		/*
 		 * not found in subtrahend: copy to result array
 		 */
@@ -943,6 +1179,11 @@ Array *Array::sub(Dataspace *data, Array *a2)
 	}
     } else {
 	objDestrCount = Object::objDestrCount;
+	if (shared != (Array *) NULL) {
+	    /* a copy of the elements has no destructed objects */
+	    unshare();
+	    v1 = elts;
+	}
 	for (n = size; n > 0; --n) {
 	    switch (v1->type) {
 	    case T_OBJECT:
@@ -960,7 +1201,7 @@ Array *Array::sub(Dataspace *data, Array *a2)
 		}
 		break;
 	    }
-	    if (search(v1, v2, a2->size, 1, FALSE) < 0) {
+	    if (!set.member(v1)) {
 		/*
 		 * not found in subtrahend: copy to result array
 		 */
@@ -989,7 +1230,7 @@ Array *Array::intersect(Dataspace *data, Array *a2)
 {
     Value *v1, *v2, *v3, *o;
     Array *a3;
-    unsigned short n;
+    asizet n;
 
     if (size == 0 || a2->size == 0) {
 	/* array & ({ }) */
@@ -999,15 +1240,15 @@ Array *Array::intersect(Dataspace *data, Array *a2)
     /* create new array */
     a3 = create(data, size);
 
-    /* copy and sort values of 2nd array */
+    /* copy values of 2nd array */
     copytmp(data, v2 = ALLOCA(Value, a2->size), a2);
-    qsort(v2, a2->size, sizeof(Value), cmp);
+    ValueSet set(v2, a2->size);
 
     v1 = Dataspace::elts(this);
     v3 = a3->elts;
     if (objDestrCount == Object::objDestrCount) {
 	for (n = size; n > 0; --n) {
-	    if (search(v1, v2, a2->size, 1, FALSE) >= 0) {
+	    if (set.member(v1)) {
 		/*
 		 * element is in both arrays: copy to result array
 		 */
@@ -1018,6 +1259,11 @@ Array *Array::intersect(Dataspace *data, Array *a2)
 	}
     } else {
 	objDestrCount = Object::objDestrCount;
+	if (shared != (Array *) NULL) {
+	    /* a copy of the elements has no destructed objects */
+	    unshare();
+	    v1 = elts;
+	}
 	for (n = size; n > 0; --n) {
 	    switch (v1->type) {
 	    case T_OBJECT:
@@ -1035,7 +1281,7 @@ Array *Array::intersect(Dataspace *data, Array *a2)
 		}
 		break;
 	    }
-	    if (search(v1, v2, a2->size, 1, FALSE) >= 0) {
+	    if (set.member(v1)) {
 		/*
 		 * element is in both arrays: copy to result array
 		 */
@@ -1065,7 +1311,7 @@ Array *Array::setAdd(Dataspace *data, Array *a2)
     Value *v, *v1, *v2, *o;
     Value *v3;
     Array *a3;
-    unsigned short n;
+    asizet n;
 
     if (size == 0) {
 	/* ({ }) | array */
@@ -1085,15 +1331,15 @@ Array *Array::setAdd(Dataspace *data, Array *a2)
     /* make room for elements to add */
     v3 = ALLOCA(Value, a2->size);
 
-    /* copy and sort values of 1st array */
+    /* copy values of 1st array */
     copytmp(data, v1 = ALLOCA(Value, size), this);
-    qsort(v1, size, sizeof(Value), cmp);
+    ValueSet set(v1, size);
 
     v = v3;
     v2 = Dataspace::elts(a2);
     if (a2->objDestrCount == Object::objDestrCount) {
 	for (n = a2->size; n > 0; --n) {
-	    if (search(v2, v1, size, 1, FALSE) < 0) {
+	    if (!set.member(v2)) {
 		/*
 		 * element is only in second array: copy to result array
 		 */
@@ -1103,6 +1349,11 @@ Array *Array::setAdd(Dataspace *data, Array *a2)
 	}
     } else {
 	a2->objDestrCount = Object::objDestrCount;
+	if (a2->shared != (Array *) NULL) {
+	    /* a copy of the elements has no destructed objects */
+	    a2->unshare();
+	    v2 = a2->elts;
+	}
 	for (n = a2->size; n > 0; --n) {
 	    switch (v2->type) {
 	    case T_OBJECT:
@@ -1120,7 +1371,7 @@ Array *Array::setAdd(Dataspace *data, Array *a2)
 		}
 		break;
 	    }
-	    if (search(v2, v1, size, 1, FALSE) < 0) {
+	    if (!set.member(v2)) {
 		/*
 		 * element is only in second array: copy to result array
 		 */
@@ -1154,8 +1405,8 @@ Array *Array::setXAdd(Dataspace *data, Array *a2)
     Value *v, *w, *v1, *v2;
     Value *v3;
     Array *a3;
-    unsigned short n, sz;
-    unsigned short num;
+    asizet n, sz;
+    asizet num;
 
     if (size == 0) {
 	/* ({ }) ^ array */
@@ -1175,9 +1426,9 @@ Array *Array::setXAdd(Dataspace *data, Array *a2)
     /* copy values of 1st array */
     copytmp(data, v1 = ALLOCA(Value, size), this);
 
-    /* copy and sort values of 2nd array */
+    /* copy values of 2nd array */
     copytmp(data, v2 = ALLOCA(Value, a2->size), a2);
-    qsort(v2, a2->size, sizeof(Value), cmp);
+    ValueSet set2(v2, a2->size);
 
     /* room for first half of result */
     v3 = ALLOCA(Value, size);
@@ -1185,7 +1436,7 @@ Array *Array::setXAdd(Dataspace *data, Array *a2)
     v = v3;
     w = v1;
     for (n = size; n > 0; --n) {
-	if (search(v1, v2, a2->size, 1, FALSE) < 0) {
+	if (!set2.member(v1)) {
 	    /*
 	     * element is only in first array: copy to result array
 	     */
@@ -1200,14 +1451,14 @@ Array *Array::setXAdd(Dataspace *data, Array *a2)
     }
     num = v - v3;
 
-    /* sort copy of 1st array */
+    /* remaining values of 1st array */
     v1 -= size;
-    qsort(v1, sz = w - v1, sizeof(Value), cmp);
+    ValueSet set1(v1, sz = w - v1);
 
     v = v2;
     w = a2->elts;
     for (n = a2->size; n > 0; --n) {
-	if (search(w, v1, sz, 1, FALSE) < 0) {
+	if (!set1.member(w)) {
 	    /*
 	     * element is only in second array: copy to 2nd result array
 	     */
@@ -1238,7 +1489,7 @@ Array *Array::setXAdd(Dataspace *data, Array *a2)
 /*
  * index an array
  */
-unsigned short Array::index(long l)
+asizet Array::index(long l)
 {
     if (l < 0 || l >= (long) size) {
 	error("Array index out of range");
@@ -1267,13 +1518,71 @@ Array *Array::range(Dataspace *data, long l1, long l2)
 	error("Invalid array range");
     }
 
-    range = create(data, l2 - l1 + 1);
-    Value::copy(range->elts, Dataspace::elts(this) + l1,
-		(unsigned short) (l2 - l1 + 1));
+    if (l2 - l1 + 1 >= SLICE_MIN) {
+	/*
+	 * share the elements until either array is modified, or the task
+	 * ends
+	 */
+	range = create(data, 0);
+	range->size = l2 - l1 + 1;
+	range->elts = Dataspace::elts(this) + l1;
+	range->objDestrCount = objDestrCount;
+	range->shared = (shared != (Array *) NULL) ? shared : this;
+	range->shared->ref();
+	range->shared->nslices++;
+	if (nslice == stabsz) {
+	    stab = REALLOC(stab, Array*, stabsz, stabsz + ARR_CHUNK);
+	    stabsz += ARR_CHUNK;
+	}
+	stab[range->sindex = nslice++] = range;
+    } else {
+	range = create(data, l2 - l1 + 1);
+	Value::copy(range->elts, Dataspace::elts(this) + l1,
+		    (asizet) (l2 - l1 + 1));
+    }
     Dataspace::refImports(range);
     return range;
 }
 
+/*
+ * give a slice its own copy of the elements, or give all slices of an
+ * array their own copies
+ */
+void Array::unshare()
+{
+    Array *a;
+    Value *v;
+    Uint i;
+
+    if (shared != (Array *) NULL) {
+	Value::copy(v = ALLOC(Value, size), elts, size);
+	elts = v;
+	stab[sindex] = stab[--nslice];
+	stab[sindex]->sindex = sindex;
+	a = shared;
+	shared = (Array *) NULL;
+	a->nslices--;
+	a->del();
+    } else {
+	for (i = nslice; nslices != 0; ) {
+	    a = stab[--i];
+	    if (a->shared == this) {
+		a->unshare();
+	    }
+	}
+    }
+}
+
+/*
+ * give all slices their own copies of the elements
+ */
+void Array::unshareAll()
+{
+    while (nslice != 0) {
+	stab[nslice - 1]->unshare();
+    }
+}
+
 
 /*
  * create a new mapping
@@ -1285,7 +1594,8 @@ Array *Array::mapCreate(Dataspace *data, long size)
     if (size > max_size << 1) {
 	error("Mapping too large");
     }
-    m = Array::alloc((unsigned short) size);
+    m = Array::alloc((asizet) size);
+    m->mapping = TRUE;
     if (size > 0) {
 	m->elts = ALLOC(Value, size);
     }
@@ -1304,7 +1614,7 @@ Array *Array::mapCreate(Dataspace *data, long size)
  */
 void Array::mapSort()
 {
-    unsigned short i, sz;
+    asizet i, sz;
     Value *v, *w;
 
     for (i = size, sz = 0, v = w = elts; i > 0; i -= 2) {
@@ -1333,6 +1643,9 @@ void Array::mapSort()
 	elts = (Value *) NULL;
     }
     size = sz;
+    if (memory != 0) {
+	charge();
+    }
 }
 
 /*
@@ -1340,7 +1653,7 @@ void Array::mapSort()
  */
 void Array::mapDehash(Dataspace *data, bool clean)
 {
-    unsigned short sz, i, j;
+    asizet sz, i, j;
     Value *v1, *v2, *v3;
 
     if (clean && size != 0) {
@@ -1451,9 +1764,9 @@ void Array::mapDehash(Dataspace *data, bool clean)
 	    /*
 	     * copy tails of arrays
 	     */
-	    memcpy(v3, v1, i * sizeof(Value));
+	    memcpy((void *) v3, v1, i * sizeof(Value));
 	    v3 += i;
-	    memcpy(v3, v2, j * sizeof(Value));
+	    memcpy((void *) v3, v2, j * sizeof(Value));
 	    v3 += j;
 
 	    v2 -= (sz - j);
@@ -1466,6 +1779,7 @@ void Array::mapDehash(Dataspace *data, bool clean)
 
 	AFREE(v2);
     }
+    chargeSize();
 }
 
 /*
@@ -1479,6 +1793,7 @@ void Array::mapRemoveHash()
 	}
 	delete hashed;
 	hashed = (MapHash *) NULL;
+	chargeSize();
     }
 }
 
@@ -1502,7 +1817,7 @@ void Array::mapCompact(Dataspace *data)
 /*
  * return the size of a mapping
  */
-unsigned short Array::mapSize(Dataspace *data)
+asizet Array::mapSize(Dataspace *data)
 {
     mapCompact(data);
     return size >> 1;
@@ -1514,7 +1829,7 @@ unsigned short Array::mapSize(Dataspace *data)
 Array *Array::mapAdd(Dataspace *data, Array *m2)
 {
     Value *v1, *v2, *v3;
-    unsigned short n1, n2;
+    asizet n1, n2;
     Int c;
     Array *m3;
 
@@ -1543,7 +1858,7 @@ Array *Array::mapAdd(Dataspace *data, Array *m2)
 		/* equal elements? */
 		if (T_INDEXED(v1->type) && v1->array != v2->array) {
 		    Value *v;
-		    unsigned short n;
+		    asizet n;
 
 		    /*
 		     * The array tags are the same, but the arrays are not.
@@ -1597,7 +1912,7 @@ Array *Array::mapAdd(Dataspace *data, Array *m2)
 Array *Array::mapSub(Dataspace *data, Array *a2)
 {
     Value *v1, *v2, *v3;
-    unsigned short n1, n2;
+    asizet n1, n2;
     Int c;
     Array *m3;
 
@@ -1633,7 +1948,7 @@ Array *Array::mapSub(Dataspace *data, Array *a2)
 	    /* equal elements? */
 	    if (T_INDEXED(v1->type) && v1->array != v2->array) {
 		Value *v;
-		unsigned short n;
+		asizet n;
 
 		/*
 		 * The array tags are the same, but the arrays are not.
@@ -1682,7 +1997,7 @@ Array *Array::mapSub(Dataspace *data, Array *a2)
 Array *Array::mapIntersect(Dataspace *data, Array *a2)
 {
     Value *v1, *v2, *v3;
-    unsigned short n1, n2;
+    asizet n1, n2;
     Int c;
     Array *m3;
 
@@ -1715,7 +2030,7 @@ Array *Array::mapIntersect(Dataspace *data, Array *a2)
 	    /* equal elements? */
 	    if (T_INDEXED(v1->type) && v1->array != v2->array) {
 		Value *v;
-		unsigned short n;
+		asizet n;
 
 		/*
 		 * The array tags are the same, but the arrays are not.
@@ -1764,11 +2079,10 @@ Array *Array::mapIntersect(Dataspace *data, Array *a2)
 Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 {
     Uint i;
-    MapElt *e, **p;
+    MapElt *e;
+    Value key;
     bool del, add, hash;
 
-    i = 0;
-
     if (elt != (Value *) NULL && VAL_NIL(elt)) {
 	elt = (Value *) NULL;
 	del = TRUE;
@@ -1780,44 +2094,16 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 	mapDehash(data, FALSE);
     }
 
-    switch (val->type) {
-    case T_NIL:
-	i = 4747;
-	break;
-
-    case T_INT:
-	i = val->number;
-	break;
-
-    case T_FLOAT:
-	i = VFLT_HASH(val);
-	break;
-
-    case T_STRING:
-	i = Hashtab::hashstr(val->string->text, STRMAPHASHSZ) ^
-							    val->string->len;
-	break;
-
-    case T_OBJECT:
-	i = val->oindex;
-	break;
-
-    case T_ARRAY:
-    case T_MAPPING:
-    case T_LWOBJECT:
-	i = (unsigned short) ((uintptr_t) val->array >> 3);
-	break;
-    }
+    i = hashindex(val);
 
     hash = FALSE;
     if (hashed != (MapHash *) NULL) {
-	p = hashed->search(val, i);
-	if (p != (MapElt **) NULL) {
+	e = hashed->search(val, i);
+	if (e != (MapElt *) NULL) {
 	    /*
 	     * found in the hashtable
 	     */
 	    hash = TRUE;
-	    e = *p;
 	    if (elt != (Value *) NULL &&
 		(verify == (Value *) NULL ||
 		 (e->val.type == T_STRING &&
@@ -1828,7 +2114,7 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 		if (val->type == T_OBJECT) {
 		    e->idx.objcnt = val->objcnt;	/* refresh */
 		}
-		if (e->add) {
+		if (hashed->added(e)) {
 		    data->assignElt(this, &e->val, elt);
 		    return &e->val;
 		} else {
@@ -1841,8 +2127,9 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 		/*
 		 * delete element
 		 */
-		add = e->add;
-		hashed->remove(p, data, this);
+		add = hashed->added(e);
+		hashed->remove(e, data, this);
+		chargeSize();
 
 		if (add) {
 		    return &Value::nil;
@@ -1895,8 +2182,9 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 		    elts = (Value *) NULL;
 		} else {
 		    /* move tail */
-		    memmove(v, v + 2, (size - n) * sizeof(Value));
+		    memmove((void *) v, v + 2, (size - n) * sizeof(Value));
 		}
+		chargeSize();
 		Dataspace::changeMap(this);
 		return &Value::nil;
 	    }
@@ -1928,16 +2216,15 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 	     * add hash table to this mapping
 	     */
 	    hashed = chunknew (mchunk) MapHash;
-	} else if (size << 2 >= hashed->tablesize * 3) {
-	    /*
-	     * extend hash table for this mapping
-	     */
-	    hashed->grow();
 	}
-	e = hashed->add(i);
+	e = hashed->add(i, add);
 
 	if (add) {
-	    e->add = TRUE;
+	    if (val->type == T_STRING) {
+		/* share short keys */
+		PUT_STRVAL_NOREF(&key, String::intern(val->string));
+		val = &key;
+	    }
 	    data->assignElt(this, &e->idx, val);
 	    data->assignElt(this, &e->val, elt);
 	    hashed->sizemod++;
@@ -1947,6 +2234,7 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
 	    e->idx = *val;
 	    e->val = *elt;
 	}
+	chargeSize();
     }
 
     return elt;
@@ -1957,7 +2245,7 @@ Value *Array::mapIndex(Dataspace *data, Value *val, Value *elt, Value *verify)
  */
 Array *Array::mapRange(Dataspace *data, Value *v1, Value *v2)
 {
-    unsigned short from, to;
+    asizet from, to;
     Array *range;
 
     mapCompact(data);
@@ -1995,7 +2283,7 @@ Array *Array::mapIndices(Dataspace *data)
 {
     Array *indices;
     Value *v1, *v2;
-    unsigned short n;
+    asizet n;
 
     mapCompact(data);
     indices = create(data, n = size >> 1);
@@ -2016,7 +2304,7 @@ Array *Array::mapValues(Dataspace *data)
 {
     Array *values;
     Value *v1, *v2;
-    unsigned short n;
+    asizet n;
 
     mapCompact(data);
     values = create(data, n = size >> 1);
@@ -2078,3 +2366,102 @@ Array *Array::lwoCopy(Dataspace *data)
     Dataspace::refImports(copy);
     return copy;
 }
+
+
+/*
+ * NAME:	chargeval()
+ * DESCRIPTION:	charge a new array in a value to a dataspace, and return the
+ *		string memory held by the value
+ */
+static Uint chargeval(Value *v, Dataspace *data)
+{
+    if (T_INDEXED(v->type)) {
+	if (v->array->memory == 0 && v->array->primary->data == data) {
+	    v->array->charge();
+	}
+	return 0;
+    }
+    return STRMEM(v);
+}
+
+/*
+ * return the memory used by this array, not counting strings
+ */
+Uint Array::memSize()
+{
+    Uint mem;
+
+    mem = sizeof(Array);
+    if (elts != (Value *) NULL) {
+	mem += size * sizeof(Value);
+    }
+    if (hashed != (MapHash *) NULL) {
+	mem += hashed->memory();
+    }
+    return mem;
+}
+
+/*
+ * replace the memory charged to the dataspace of this array
+ */
+void Array::account(Uint mem, Uint smem)
+{
+    size_t *used;
+
+    used = primary->data->memUsed;
+    used[(mapping) ? DM_MAPPINGS : DM_ARRAYS] += mem;
+    used[(mapping) ? DM_MAPPINGS : DM_ARRAYS] -= memory;
+    used[DM_STRINGS] += smem;
+    used[DM_STRINGS] -= strMemory;
+    memory = mem;
+    strMemory = smem;
+}
+
+/*
+ * charge the memory of this array to its dataspace, together with that
+ * of new arrays of the same dataspace nested inside it
+ */
+void Array::charge()
+{
+    Dataspace *data;
+    Value *v;
+    asizet i;
+    Uint j, mem, smem;
+    MapElt *e;
+
+    data = primary->data;
+    mem = memSize();
+    account(mem, strMemory);	/* mark as charged */
+
+    smem = 0;
+    if (elts != (Value *) NULL) {
+	for (v = elts, i = size; i != 0; v++, --i) {
+	    smem += chargeval(v, data);
+	}
+    }
+    if (hashed != (MapHash *) NULL) {
+	for (j = 0; (e=hashed->nextAdded(&j)) != (MapElt *) NULL; ) {
+	    smem += chargeval(&e->idx, data);
+	    smem += chargeval(&e->val, data);
+	}
+    }
+    account(mem, smem);
+}
+
+/*
+ * update the memory charged for a change in size
+ */
+void Array::chargeSize()
+{
+    if (memory != 0) {
+	account(memSize(), strMemory);
+    }
+}
+
+/*
+ * remove the memory charged to the dataspace of this array
+ */
+void Array::discharge()
+{
+    account(0, 0);
+}
@@ -21,7 +21,7 @@ class Array : public ChunkAllocated {
 public:
     class Backup;			/* array backup chunk */
 
-    Array(unsigned short size);
+    Array(asizet size);
     Array() {
 	prev = next = this;		/* alist sentinel */
     }
@@ -39,14 +39,15 @@ public:
     Array *intersect(Dataspace *data, Array *a2);
     Array *setAdd(Dataspace *data, Array *a2);
     Array *setXAdd(Dataspace *data, Array *a2);
-    unsigned short index(long l);
+    asizet index(long l);
     void checkRange(long l1, long l2);
     Array *range(Dataspace *data, long l1, long l2);
+    void unshare();
 
     void mapSort();
     void mapRemoveHash();
     void mapCompact(Dataspace *data);
-    unsigned short mapSize(Dataspace *data);
+    asizet mapSize(Dataspace *data);
     Array *mapAdd(Dataspace *data, Array *m2);
     Array *mapSub(Dataspace *data, Array *a2);
     Array *mapIntersect(Dataspace *data, Array *a2);
@@ -57,6 +58,10 @@ public:
 
     Array *lwoCopy(Dataspace *data);
 
+    void charge();
+    void chargeSize();
+    void discharge();
+
     static void init(unsigned int size);
     static Array *alloc(unsigned int size);
     static Array *create(Dataspace *data, long size);
@@ -66,23 +71,33 @@ public:
     static void clear();
     static void commit(Backup **ac, Dataplane *plane, bool merge);
     static void discard(Backup **ac);
+    static void unshareAll();
 
     static Array *mapCreate(Dataspace *data, long size);
 
     static Array *lwoCreate(Dataspace *data, Object *obj);
 
-    unsigned short size;		/* number of elements */
+    asizet size;			/* number of elements */
     bool hashmod;			/* hashed part contains new elements */
+    bool mapping;			/* charged as a mapping */
     Uint refCount;			/* number of references */
     Uint tag;				/* used in sorting */
     Uint objDestrCount;			/* last destructed object count */
+    Uint memory;			/* memory charged to dataspace */
+    Uint strMemory;			/* string memory charged to dataspace */
     Value *elts;			/* elements */
     class MapHash *hashed;		/* hashed mapping elements */
     struct ArrRef *primary;		/* primary reference */
     Array *prev, *next;			/* per-object linked list */
+    Array *shared;			/* slice: shares elements of this array */
+    Uint nslices;			/* # slices sharing the elements */
 
 private:
     void mapDehash(Dataspace *data, bool clean);
+    Uint memSize();
+    void account(Uint mem, Uint smem);
+
+    Uint sindex;			/* index in the table of slices */
 
     static unsigned long max_size;	/* max. size of array and mapping */
     static Uint atag;			/* current array tag */
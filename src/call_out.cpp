@@ -523,7 +523,7 @@ void CallOut::del(unsigned int oindex, unsigned int handle, Uint t,
 void CallOut::list(Array *a)
 {
     Value *v, *w;
-    unsigned short i;
+    asizet i;
     Uint t;
     unsigned short m;
     Float flt1, flt2;
@@ -170,7 +170,7 @@ static void block_goto(Node *g)
 	}
     }
 
-    c_error("unknown label: %s", g->l.string->text);
+    c_error("unknown label: %s", (char *) g->l.string->text);
 }
 
 /*
@@ -756,7 +756,7 @@ static void c_decl_func(unsigned short sclass, Node *type, String *str,
     } else {
 	typechecked = TRUE;
 	if (t != T_VOID && (t & T_TYPE) == T_VOID) {
-	    c_error("invalid type for function %s (%s)", str->text,
+	    c_error("invalid type for function %s (%s)", (char *) str->text,
 		    Value::typeName(tnbuf, t));
 	    t = T_MIXED;
 	}
@@ -784,7 +784,7 @@ static void c_decl_func(unsigned short sclass, Node *type, String *str,
 	    break;
 	}
 	if (nargs == MAX_LOCALS) {
-	    c_error("too many parameters in function %s", str->text);
+	    c_error("too many parameters in function %s", (char *) str->text);
 	    break;
 	}
 
@@ -798,12 +798,13 @@ static void c_decl_func(unsigned short sclass, Node *type, String *str,
 	t = type->mod;
 	if ((t & T_TYPE) == T_NIL) {
 	    if (typechecked) {
-		c_error("missing type for parameter %s", type->l.string->text);
+		c_error("missing type for parameter %s",
+			(char *) type->l.string->text);
 	    }
 	    t = T_MIXED;
 	} else if ((t & T_TYPE) == T_VOID) {
-	    c_error("invalid type for parameter %s (%s)", type->l.string->text,
-		    Value::typeName(tnbuf, t));
+	    c_error("invalid type for parameter %s (%s)",
+		    (char *) type->l.string->text, Value::typeName(tnbuf, t));
 	    t = T_MIXED;
 	} else if (typechecked && t != T_MIXED) {
 	    /* only bother to typecheck functions with non-mixed arguments */
@@ -811,7 +812,8 @@ static void c_decl_func(unsigned short sclass, Node *type, String *str,
 	}
 	if (type->flags & F_VARARGS) {
 	    if (varargs) {
-		c_error("extra varargs for parameter %s", type->l.string->text);
+		c_error("extra varargs for parameter %s",
+			(char *) type->l.string->text);
 	    }
 	    varargs = TRUE;
 	}
@@ -820,7 +822,7 @@ static void c_decl_func(unsigned short sclass, Node *type, String *str,
 	    varargs = TRUE;
 	    if (((t + (1 << REFSHIFT)) & T_REF) == 0) {
 		c_error("too deep indirection for parameter %s",
-			type->l.string->text);
+			(char *) type->l.string->text);
 	    }
 	    if (function) {
 		block_pdef(type->l.string->text, t + (1 << REFSHIFT),
@@ -863,18 +865,18 @@ static void c_decl_var(unsigned short sclass, Node *type, String *str,
     char tnbuf[TNBUFSIZE];
 
     if ((type->mod & T_TYPE) == T_VOID) {
-	c_error("invalid type for variable %s (%s)", str->text,
+	c_error("invalid type for variable %s (%s)", (char *) str->text,
 		Value::typeName(tnbuf, type->mod));
 	type->mod = T_MIXED;
     }
     if (global) {
 	if (sclass & (C_ATOMIC | C_NOMASK | C_VARARGS)) {
-	    c_error("invalid class for variable %s", str->text);
+	    c_error("invalid class for variable %s", (char *) str->text);
 	}
 	Control::defVar(str, sclass, type->mod, type->sclass);
     } else {
 	if (sclass != 0) {
-	    c_error("invalid class for variable %s", str->text);
+	    c_error("invalid class for variable %s", (char *) str->text);
 	}
 	block_vdef(str->text, type->mod, type->sclass);
     }
@@ -1652,7 +1654,8 @@ Node *c_label(Node *n)
     for (b = thisblock; b != (block *) NULL; b = b->prev) {
 	for (l = b->labels; l != (Node *) NULL; l = l->r.right) {
 	    if (n->l.string->cmp(l->l.string) == 0) {
-		c_error("redeclaration of label: %s", n->l.string->text);
+		c_error("redeclaration of label: %s",
+			(char *) n->l.string->text);
 		return NULL;
 	    }
 	}
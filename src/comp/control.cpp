@@ -32,6 +32,7 @@
 static Control *chead, *ctail;		/* list of control blocks */
 static Sector nctrl;			/* # control blocks */
 static Control *newctrl;		/* the new control block */
+static Uint lastgen;			/* last call cache generation */
 
 /*
  * create a new control block
@@ -86,6 +87,12 @@ Control::Control()
     vtypes = (char *) NULL;
     vmapsize = 0;
     vmap = (unsigned short *) NULL;
+    dcode = (Uint **) NULL;
+    nccache = 0;
+    ccache = (CallCache *) NULL;
+    callgen = ++lastgen;
+    ncalls = nloops = 0;
+    fcalls = (Uint *) NULL;
 }
 
 /*
@@ -136,6 +143,7 @@ Control::~Control()
 {
     String **strs;
     unsigned short i;
+    Uint n;
 
     /* delete strings */
     if (strings != (String **) NULL) {
@@ -222,6 +230,27 @@ Control::~Control()
 	FREE(vtypes);
     }
 
+    /* delete decoded code */
+    if (dcode != (Uint **) NULL) {
+	for (i = 0; i < nfuncdefs; i++) {
+	    if (dcode[i] != (Uint *) NULL) {
+		FREE(dcode[i]);
+	    }
+	}
+	FREE(dcode);
+    }
+    if (ccache != (CallCache *) NULL) {
+	for (n = 0; n < nccache; n++) {
+	    if (ccache[n].ctrl != (Control *) NULL) {
+		ccache[n].name->del();
+	    }
+	}
+	FREE(ccache);
+    }
+    if (fcalls != (Uint *) NULL) {
+	FREE(fcalls);
+    }
+
     if (this != chead) {
 	prev->next = next;
     } else {
@@ -495,7 +524,7 @@ void Control::inheritVars(ObjHash *ohash)
 	    } else {
 	       /* duplicate variable */
 	       c_error("multiple inheritance of variable %s (/%s, /%s)",
-		       str->text, (*h)->ohash->name, ohash->name);
+		       (char *) str->text, (*h)->ohash->name, ohash->name);
 	    }
 	}
 	v++;
@@ -599,8 +628,8 @@ void Control::inheritFunc(int idx, ObjHash *ohash)
 	/*
 	 * privately inherited nomask function is not allowed
 	 */
-	c_error("private inherit of nomask function %s (/%s)", str->text,
-		ohash->name);
+	c_error("private inherit of nomask function %s (/%s)",
+		(char *) str->text, ohash->name);
 	return;
     }
 
@@ -730,7 +759,8 @@ void Control::inheritFunc(int idx, ObjHash *ohash)
 			 * a nomask function is inherited more than once
 			 */
 			c_error("multiple inheritance of nomask function %s (/%s, /%s)",
-				str->text, (*l)->ohash->name, ohash->name);
+				(char *) str->text, (*l)->ohash->name,
+				ohash->name);
 			return;
 		    }
 		    if (((f->sclass | PROTO_CLASS(prot2)) & C_UNDEFINED) &&
@@ -739,7 +769,8 @@ void Control::inheritFunc(int idx, ObjHash *ohash)
 			 * prototype conflict
 			 */
 			c_error("unequal prototypes for function %s (/%s, /%s)",
-				str->text, (*l)->ohash->name, ohash->name);
+				(char *) str->text, (*l)->ohash->name,
+				ohash->name);
 			return;
 		    }
 
@@ -863,7 +894,7 @@ bool Control::inherit(Frame *f, char *from, Object *obj, String *label,
 	 * use a label
 	 */
 	if (Label::find(label->text) != (ObjHash *) NULL) {
-	    c_error("redeclaration of label %s", label->text);
+	    c_error("redeclaration of label %s", (char *) label->text);
 	}
 	new Label(label, ohash);
     }
@@ -1017,9 +1048,17 @@ public:
      * copy or dereference when iterating through items
      */
     virtual bool item(StrPtr *s) {
+	String *str;
+
 	if (copy != (String **) NULL) {
-	    *--copy = s->str;
-	    strsize += s->str->len;
+	    /* share short strings with other programs */
+	    str = String::intern(s->str);
+	    if (str != s->str) {
+		str->ref();
+		s->str->del();
+	    }
+	    *--copy = str;
+	    strsize += str->len;
 	} else {
 	    s->str->del();
 	}
@@ -1264,19 +1303,21 @@ void Control::defProto(String *str, char *proto, String *sclass)
 		/*
 		 * both prototypes are from functions
 		 */
-		c_error("multiple declaration of function %s", str->text);
+		c_error("multiple declaration of function %s",
+			(char *) str->text);
 	    } else if (!newctrl->compareProto(proto, newctrl, proto2)) {
 		if ((PROTO_CLASS(proto) ^ PROTO_CLASS(proto2)) & C_UNDEFINED) {
 		    /*
 		     * declaration does not match prototype
 		     */
 		    c_error("declaration does not match prototype of %s",
-			    str->text);
+			    (char *) str->text);
 		} else {
 		    /*
 		     * unequal prototypes
 		     */
-		    c_error("unequal prototypes for function %s", str->text);
+		    c_error("unequal prototypes for function %s",
+			    (char *) str->text);
 		}
 	    } else if (!(PROTO_CLASS(proto) & C_UNDEFINED) ||
 		       PROTO_FTYPE(proto2) == T_IMPLICIT) {
@@ -1322,7 +1363,7 @@ void Control::defProto(String *str, char *proto, String *sclass)
 		 * declaration does not match inherited prototype
 		 */
 		c_error("inherited different prototype for %s (/%s)",
-			str->text, (*h)->ohash->name);
+			(char *) str->text, (*h)->ohash->name);
 	    } else if ((PROTO_CLASS(proto) & C_UNDEFINED) &&
 		       (*h)->ohash->priv == 0 &&
 		       (ctrl->ninherits != 1 ||
@@ -1341,7 +1382,7 @@ void Control::defProto(String *str, char *proto, String *sclass)
 		 * attempt to redefine nomask function
 		 */
 		c_error("redeclaration of nomask function %s (/%s)",
-			str->text, (*h)->ohash->name);
+			(char *) str->text, (*h)->ohash->name);
 	    }
 
 	    if ((*l)->ohash->priv != 0) {
@@ -1431,13 +1472,13 @@ void Control::defVar(String *str, unsigned int sclass, unsigned int type,
     h = (VFH **) vtab->lookup(str->text, FALSE);
     if (*h != (VFH *) NULL) {
 	if ((*h)->ohash == newohash) {
-	    c_error("redeclaration of variable %s", str->text);
+	    c_error("redeclaration of variable %s", (char *) str->text);
 	    return;
 	} else if (!(sclass & C_PRIVATE)) {
 	    /*
 	     * non-private redeclaration of a variable
 	     */
-	    c_error("redeclaration of variable %s (/%s)", str->text,
+	    c_error("redeclaration of variable %s (/%s)", (char *) str->text,
 		    (*h)->ohash->name);
 	    return;
 	}
@@ -1504,7 +1545,7 @@ char *Control::iFunCall(String *str, const char *label, String **cfstr,
 		    *call = ((long) KFCALL << 24) | index;
 		    return KFUN(index).proto;
 		}
-		c_error("undefined function %s::%s", label, str->text);
+		c_error("undefined function %s::%s", label, (char *) str->text);
 		return (char *) NULL;
 	    }
 	}
@@ -1525,7 +1566,7 @@ char *Control::iFunCall(String *str, const char *label, String **cfstr,
 		*call = ((long) KFCALL << 24) | index;
 		return KFUN(index).proto;
 	    }
-	    c_error("undefined function ::%s", str->text);
+	    c_error("undefined function ::%s", (char *) str->text);
 	    return (char *) NULL;
 	}
 	ohash = h->ohash;
@@ -1533,7 +1574,7 @@ char *Control::iFunCall(String *str, const char *label, String **cfstr,
 	    /*
 	     * call to multiple inherited function
 	     */
-	    c_error("ambiguous call to function ::%s", str->text);
+	    c_error("ambiguous call to function ::%s", (char *) str->text);
 	    return (char *) NULL;
 	}
 	index = h->index;
@@ -1542,7 +1583,7 @@ char *Control::iFunCall(String *str, const char *label, String **cfstr,
 
     ctrl = ohash->obj->ctrl;
     if (ctrl->funcdefs[index].sclass & C_UNDEFINED) {
-	c_error("undefined function %s::%s", label, str->text);
+	c_error("undefined function %s::%s", label, (char *) str->text);
 	return (char *) NULL;
     }
     *call = ((long) DFCALL << 24) | ((long) ohash->index << 8) | index;
@@ -1602,7 +1643,7 @@ char *Control::funCall(String *str, String **cfstr, long *call,
 	/*
 	 * call to multiple inherited function
 	 */
-	c_error("ambiguous call to function %s", str->text);
+	c_error("ambiguous call to function %s", (char *) str->text);
 	return (char *) NULL;
     } else {
 	Control *ctrl;
@@ -1623,7 +1664,7 @@ char *Control::funCall(String *str, String **cfstr, long *call,
 
     if (typechecking && PROTO_FTYPE(proto) == T_IMPLICIT) {
 	/* don't allow calls to implicit prototypes when typechecking */
-	c_error("undefined function %s", str->text);
+	c_error("undefined function %s", (char *) str->text);
 	return (char *) NULL;
     }
 
@@ -1689,7 +1730,7 @@ unsigned short Control::var(String *str, long *ref, String **cvstr)
     /* check if the variable exists */
     h = *(VFH **) vtab->lookup(str->text, TRUE);
     if (h == (VFH *) NULL) {
-	c_error("undeclared variable %s", str->text);
+	c_error("undeclared variable %s", (char *) str->text);
 	if (nvars < 255) {
 	    /* don't repeat this error */
 	    defVar(str, 0, T_MIXED, (String *) NULL);
@@ -2727,6 +2768,107 @@ char *Control::program()
     return prog;
 }
 
+/*
+ * get the decoded code of a function, decoding it if necessary
+ */
+Uint *Control::code(int funci)
+{
+    if (dcode == (Uint **) NULL) {
+	dcode = ALLOC(Uint*, nfuncdefs);
+	memset(dcode, '\0', nfuncdefs * sizeof(Uint*));
+    }
+    if (dcode[funci] == (Uint *) NULL) {
+	dcode[funci] = Frame::decode(this, program() + funcs()[funci].offset);
+    }
+    return dcode[funci];
+}
+
+/*
+ * allocate a call cache for a call site in this program
+ */
+Uint Control::addCallCache()
+{
+    if ((nccache & 15) == 0) {
+	ccache = REALLOC(ccache, CallCache, nccache, nccache + 16);
+    }
+    ccache[nccache].ctrl = (Control *) NULL;
+    return nccache++;
+}
+
+/*
+ * get a call cache
+ */
+CallCache *Control::callCache(Uint n)
+{
+    return &ccache[n];
+}
+
+/*
+ * count a call to a function in this program
+ */
+void Control::countCall(int funci)
+{
+    if (fcalls == (Uint *) NULL) {
+	fcalls = ALLOC(Uint, nfuncdefs);
+	memset(fcalls, '\0', nfuncdefs * sizeof(Uint));
+    }
+    fcalls[funci]++;
+    ncalls++;
+}
+
+/*
+ * return a mapping with the number of calls to each function called in this
+ * program
+ */
+Array *Control::callCounts(Dataspace *data)
+{
+    FuncDef *f;
+    Value *v;
+    Array *m;
+    int i, size;
+
+    size = 0;
+    if (fcalls != (Uint *) NULL) {
+	for (i = 0; i < nfuncdefs; i++) {
+	    if (fcalls[i] != 0) {
+		size += 2;
+	    }
+	}
+    }
+
+    m = Array::mapCreate(data, size);
+    if (size != 0) {
+	v = m->elts;
+	for (i = 0, f = funcs(); i < nfuncdefs; i++, f++) {
+	    if (fcalls[i] != 0) {
+		PUT_STRVAL(v, strconst(f->inherit, f->index));
+		PUT_INTVAL(v + 1, fcalls[i]);
+		v += 2;
+	    }
+	}
+	try {
+	    ErrorContext::push();
+	    m->mapSort();
+	    ErrorContext::pop();
+	} catch (...) {
+	    /* discard mapping */
+	    m->ref();
+	    m->del();
+	    error((char *) NULL);	/* pass on error */
+	}
+    }
+
+    return m;
+}
+
+/*
+ * invalidate call caches for this program
+ */
+void Control::flushCalls()
+{
+    callgen = ++lastgen;
+}
+
 /*
  * DESCRIPTION:	load strings text
  */
@@ -2793,7 +2935,7 @@ String *Control::strconst(int inherit, Uint idx)
     if (strings[idx] == (String *) NULL) {
 	String *str;
 
-	str = String::alloc(stext + ssindex[idx], sslength[idx]);
+	str = String::intern(stext + ssindex[idx], sslength[idx]);
 	strings[idx] = str;
 	str->ref();
     }
@@ -3259,6 +3401,39 @@ Symbol *Control::symb(const char *func, unsigned int len)
     return (Symbol *) NULL;
 }
 
+/*
+ * find a function in the symbol table, trying the call cache first
+ */
+Symbol *Control::symb(const char *func, unsigned int len, CallCache *cache)
+{
+    Symbol *symb;
+    Control *ctrl;
+    FuncDef *f;
+
+    if (cache == (CallCache *) NULL) {
+	return this->symb(func, len);
+    }
+    if (cache->ctrl == this && cache->gen == callgen &&
+	len == cache->name->len && memcmp(func, cache->name->text, len) == 0) {
+	return &cache->symb;
+    }
+
+    symb = this->symb(func, len);
+    if (symb != (Symbol *) NULL) {
+	ctrl = OBJR(inherits[UCHAR(symb->inherit)].oindex)->control();
+	f = ctrl->funcs() + UCHAR(symb->index);
+	if (cache->ctrl != (Control *) NULL) {
+	    cache->name->del();
+	}
+	cache->ctrl = this;
+	cache->gen = callgen;
+	cache->name = ctrl->strconst(f->inherit, f->index);
+	cache->name->ref();
+	cache->symb = *symb;
+    }
+    return symb;
+}
+
 /*
  * list the undefined functions in a program
  */
@@ -3298,7 +3473,7 @@ Array *Control::undefined(Dataspace *data)
     try {
 	ErrorContext::push();
 	m = Array::mapCreate(data, size);
-	memset(m->elts, '\0', size * sizeof(Value));
+	memset((void *) m->elts, '\0', size * sizeof(Value));
 	for (i = nsymbols, symb = symbols; i != 0; --i, symb++) {
 	    obj = OBJR(inherits[UCHAR(symb->inherit)].oindex);
 	    ctrl = (O_UPGRADING(obj)) ? OBJR(obj->prev)->ctrl : obj->control();
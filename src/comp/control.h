@@ -51,6 +51,13 @@ struct Symbol {
 
 # define DSYM_LAYOUT	"ccs"
 
+struct CallCache {
+    Control *ctrl;		/* program called */
+    Uint gen;			/* call cache generation */
+    String *name;		/* function name */
+    Symbol symb;		/* cached symbol */
+};
+
 class Control : public Allocated {
 public:
     void ref();
@@ -60,6 +67,7 @@ public:
     unsigned short *varmap(Control *octrl);
     void setVarmap(unsigned short *vmap);
     char *program();
+    Uint *code(int funci);
     String *strconst(int inherit, Uint idx);
     FuncDef *funcs();
     VarDef *vars();
@@ -67,6 +75,12 @@ public:
     char *varTypes();
     Uint progSize();
     Symbol *symb(const char *func, unsigned int len);
+    Symbol *symb(const char *func, unsigned int len, CallCache *cache);
+    Uint addCallCache();
+    CallCache *callCache(Uint n);
+    void countCall(int funci);
+    void flushCalls();
+    Array *callCounts(Dataspace *data);
     Array *undefined(Dataspace *data);
 
     static void prepare();
@@ -143,6 +157,9 @@ public:
     unsigned short vmapsize;	/* i/o size of variable mapping */
     unsigned short *vmap;	/* variable mapping */
 
+    Uint ncalls;		/* # calls to functions in this program */
+    Uint nloops;		/* # loop iterations in this program */
+
 private:
     Control();
     virtual ~Control();
@@ -185,6 +202,12 @@ private:
 
     char *vtypes;		/* i/o? variable types */
 
+    Uint **dcode;		/* decoded function code */
+    Uint nccache;		/* # call caches */
+    CallCache *ccache;		/* call caches */
+    Uint callgen;		/* call cache generation */
+    Uint *fcalls;		/* # calls per function */
+
     Uint progoffset;		/* o program text offset */
     Uint stroffset;		/* o offset of string index table */
     Uint funcdoffset;		/* o offset of function definition table */
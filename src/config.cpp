@@ -39,6 +39,7 @@
 # include "parser.h"
 # include "compile.h"
 # include "table.h"
+# include "profile.h"
 
 struct config {
     const char *name;	/* name of the option */
@@ -53,78 +54,97 @@ struct config {
 };
 
 static config conf[] = {
-# define ARRAY_SIZE	0
+# define ARENA_SIZE	0
+				{ "arena_size",		INT_CONST, FALSE, FALSE,
+							2097152 },
+# define ARRAY_SIZE	1
 				{ "array_size",		INT_CONST, FALSE, FALSE,
-							1, USHRT_MAX / 2 },
-# define AUTO_OBJECT	1
+							1, ASIZET_MAX / 2 },
+# define AUTO_OBJECT	2
 				{ "auto_object",	STRING_CONST, TRUE },
-# define BINARY_PORT	2
+# define BINARY_PORT	3
 				{ "binary_port",	'[', FALSE, FALSE,
 							1, USHRT_MAX },
-# define CACHE_SIZE	3
+# define CACHE_POLICY	4
+				{ "cache_policy",	INT_CONST, FALSE, FALSE,
+							0, 1 },
+# define CACHE_SIZE	5
 				{ "cache_size",		INT_CONST, FALSE, FALSE,
 							1, UINDEX_MAX },
-# define CALL_OUTS	4
+# define CALL_OUTS	6
 				{ "call_outs",		INT_CONST, FALSE, FALSE,
 							0, UINDEX_MAX - 1 },
-# define CREATE		5
+# define CREATE		7
 				{ "create",		STRING_CONST },
-# define DATAGRAM_PORT	6
+# define DATAGRAM_PORT	8
 				{ "datagram_port",	'[', FALSE, FALSE,
 							1, USHRT_MAX },
-# define DATAGRAM_USERS	7
+# define DATAGRAM_USERS	9
 				{ "datagram_users",	INT_CONST, FALSE, FALSE,
 							0, EINDEX_MAX },
-# define DIRECTORY	8
+# define DIRECTORY	10
 				{ "directory",		STRING_CONST },
-# define DRIVER_OBJECT	9
+# define DRIVER_OBJECT	11
 				{ "driver_object",	STRING_CONST, TRUE },
-# define DUMP_FILE	10
+# define DUMP_FILE	12
 				{ "dump_file",		STRING_CONST },
-# define DUMP_INTERVAL	11
+# define DUMP_INTERVAL	13
 				{ "dump_interval",	INT_CONST },
-# define DYNAMIC_CHUNK	12
+# define DYNAMIC_CHUNK	14
 				{ "dynamic_chunk",	INT_CONST, FALSE, FALSE,
 							1024 },
-# define ED_TMPFILE	13
+# define ED_TMPFILE	15
 				{ "ed_tmpfile",		STRING_CONST },
-# define EDITORS	14
+# define EDITORS	16
 				{ "editors",		INT_CONST, FALSE, FALSE,
 							0, EINDEX_MAX },
-# define HOTBOOT	15
+# define HOTBOOT	17
 				{ "hotboot",		'(' },
-# define INCLUDE_DIRS	16
+# define HUGE_PAGES	18
+				{ "huge_pages",		INT_CONST, FALSE, FALSE,
+							0, 2 },
+# define INCLUDE_DIRS	19
 				{ "include_dirs",	'(' },
-# define INCLUDE_FILE	17
+# define INCLUDE_FILE	20
 				{ "include_file",	STRING_CONST, TRUE },
-# define MODULES	18
+# define JIT_CALLS	21
+				{ "jit_calls",		INT_CONST },
+# define JIT_LOOPS	22
+				{ "jit_loops",		INT_CONST },
+# define MODULES	23
 				{ "modules",		']' },
-# define OBJECTS	19
+# define OBJECTS	24
 				{ "objects",		INT_CONST, FALSE, FALSE,
 							2, UINDEX_MAX },
-# define SECTOR_SIZE	20
+# define PROFILE_ALLOC	25
+				{ "profile_alloc",	INT_CONST, FALSE, FALSE,
+							4096 },
+# define PROFILE_RATE	26
+				{ "profile_rate",	INT_CONST, FALSE, FALSE,
+							0, 1000 },
+# define SECTOR_SIZE	27
 				{ "sector_size",	INT_CONST, FALSE, FALSE,
 							512, 65535 },
-# define STATIC_CHUNK	21
+# define STATIC_CHUNK	28
 				{ "static_chunk",	INT_CONST },
-# define SWAP_FILE	22
+# define SWAP_FILE	29
 				{ "swap_file",		STRING_CONST },
-# define SWAP_FRAGMENT	23
+# define SWAP_FRAGMENT	30
 				{ "swap_fragment",	INT_CONST, FALSE, FALSE,
 							0, SW_UNUSED },
-# define SWAP_SIZE	24
+# define SWAP_SIZE	31
 				{ "swap_size",		INT_CONST, FALSE, FALSE,
 							1024, SW_UNUSED },
-# define TELNET_PORT	25
+# define TELNET_PORT	32
 				{ "telnet_port",	'[', FALSE, FALSE,
 							1, USHRT_MAX },
-# define TYPECHECKING	26
+# define TYPECHECKING	33
 				{ "typechecking",	INT_CONST, FALSE, FALSE,
 							0, 2 },
-# define USERS		27
+# define USERS		34
 				{ "users",		INT_CONST, FALSE, FALSE,
 							0, EINDEX_MAX },
-# define NR_OPTIONS	28
+# define NR_OPTIONS	35
 };
 
 
@@ -163,7 +183,7 @@ static dumpinfo header;		/* snapshot header */
 # define utsize	(header[20])	/* sizeof(uindex) + sizeof(ssizet) */
 # define desize	(header[21])	/* sizeof(sector) + sizeof(eindex) */
 # define psize	(header[22])	/* sizeof(char*), upper nibble reserved */
-# define calign	(header[23])	/* align(char) */
+# define calign	(header[23])	/* align(char), upper nibble arrsize */
 # define salign	(header[24])	/* align(short) */
 # define ialign	(header[25])	/* align(Int) */
 # define palign	(header[26])	/* align(char*) */
@@ -178,6 +198,7 @@ static int ualign;		/* align(uindex) */
 static int talign;		/* align(ssizet) */
 static int dalign;		/* align(sector) */
 static int ealign;		/* align(eindex) */
+static int aalign;		/* align(asizet) */
 static dumpinfo rheader;	/* restored header */
 # define rs0	(rheader[ 6])	/* short, msb */
 # define rs1	(rheader[ 7])	/* short, lsb */
@@ -188,7 +209,7 @@ static dumpinfo rheader;	/* restored header */
 # define rutsize (rheader[20])	/* sizeof(uindex) + sizeof(ssizet) */
 # define rdesize (rheader[21])	/* sizeof(sector) + sizeof(eindex) */
 # define rpsize	(rheader[22])	/* sizeof(char*), upper nibble reserved */
-# define rcalign (rheader[23])	/* align(char) */
+# define rcalign (rheader[23])	/* align(char), upper nibble arrsize */
 # define rsalign (rheader[24])	/* align(short) */
 # define rialign (rheader[25])	/* align(Int) */
 # define rpalign (rheader[26])	/* align(char*) */
@@ -207,6 +228,8 @@ static int rualign;		/* align(uindex) */
 static int rtalign;		/* align(ssizet) */
 static int rdalign;		/* align(sector) */
 static int realign;		/* align(eindex) */
+static int rasize;		/* sizeof(asizet) */
+static int raalign;		/* align(asizet) */
 static Uint starttime;		/* start time */
 static Uint elapsed;		/* elapsed time */
 static Uint boottime;		/* boot time */
@@ -260,6 +283,10 @@ static void conf_dumpinit()
     case sizeof(short):	ealign = salign; break;
     case sizeof(Int):	ealign = ialign; break;
     }
+    aalign = (sizeof(asizet) == sizeof(short)) ? salign : ialign;
+    if (sizeof(asizet) != sizeof(short)) {
+	calign |= sizeof(asizet) << 4;
+    }
 }
 
 /*
@@ -406,9 +433,11 @@ static bool conf_restore(int fd, int fd2)
     if (resize == 0) {
 	resize = sizeof(char);			/* backward compat */
     }
-    if ((rcalign >> 4) != 0) {
-	error("Cannot restore arrsize > 2");
+    rasize = UCHAR(rcalign) >> 4;
+    if (rasize == 0) {
+	rasize = sizeof(unsigned short);	/* backward compat */
     }
+    rcalign &= 0xf;
     if ((rsalign >> 4) != 0) {
 	error("Cannot restore Int size > 4");
     }
@@ -421,10 +450,14 @@ static bool conf_restore(int fd, int fd2)
     case sizeof(short):	realign = rsalign; break;
     case sizeof(Int):	realign = rialign; break;
     }
+    raalign = (rasize == sizeof(short)) ? rsalign : rialign;
     if (sizeof(uindex) < rusize || sizeof(ssizet) < rtsize ||
 	sizeof(Sector) < rdsize) {
 	error("Cannot restore uindex, ssizet or sector of greater width");
     }
+    if ((int) sizeof(asizet) < rasize) {
+	error("Cannot restore arrsize of greater width");
+    }
     if ((rpsize >> 4) > 1) {
 	error("Cannot restore hindex > 1");	/* Hydra only */
     }
@@ -485,7 +518,7 @@ Uint conf_dsize(const char *layout)
 	switch (*p++) {
 	case 'c':	/* character */
 	    sz = rsz = sizeof(char);
-	    al = calign;
+	    al = calign & 0xf;
 	    ral = rcalign;
 	    break;
 
@@ -529,6 +562,13 @@ Uint conf_dsize(const char *layout)
 	    ral = realign;
 	    break;
 
+	case 'a':	/* asizet */
+	    sz = sizeof(asizet);
+	    rsz = rasize;
+	    al = aalign;
+	    ral = raalign;
+	    break;
+
 	case 'p':	/* pointer */
 	    sz = sizeof(char*);
 	    rsz = rpsize;
@@ -599,7 +639,7 @@ Uint conf_dconv(char *buf, char *rbuf, const char *layout, Uint n)
 	for (p = layout; *p != '\0' && *p != ']'; p++) {
 	    switch (*p) {
 	    case 'c':
-		i = ALGN(i, calign);
+		i = ALGN(i, calign & 0xf);
 		ri = ALGN(ri, rcalign);
 		buf[i] = rbuf[ri];
 		i += sizeof(char);
@@ -706,6 +746,29 @@ Uint conf_dconv(char *buf, char *rbuf, const char *layout, Uint n)
 		ri += resize;
 		break;
 
+	    case 'a':
+		i = ALGN(i, aalign);
+		ri = ALGN(ri, raalign);
+		if (sizeof(asizet) == rasize) {
+		    if (sizeof(asizet) == sizeof(short)) {
+			buf[i + s0] = rbuf[ri + rs0];
+			buf[i + s1] = rbuf[ri + rs1];
+		    } else {
+			buf[i + i0] = rbuf[ri + ri0];
+			buf[i + i1] = rbuf[ri + ri1];
+			buf[i + i2] = rbuf[ri + ri2];
+			buf[i + i3] = rbuf[ri + ri3];
+		    }
+		} else {
+		    buf[i + i0] = 0;
+		    buf[i + i1] = 0;
+		    buf[i + i2] = rbuf[ri + rs0];
+		    buf[i + i3] = rbuf[ri + rs1];
+		}
+		i += sizeof(asizet);
+		ri += rasize;
+		break;
+
 	    case 'p':
 		i = ALGN(i, palign);
 		ri = ALGN(ri, rpalign);
@@ -1094,8 +1157,11 @@ static bool conf_config()
     }
 
     for (l = 0; l < NR_OPTIONS; l++) {
-	if (!conf[l].set && l != HOTBOOT && l != MODULES && l != CACHE_SIZE &&
-	    l != DATAGRAM_PORT && l != DATAGRAM_USERS) {
+	if (!conf[l].set && l != HOTBOOT && l != MODULES &&
+	    l != CACHE_POLICY && l != CACHE_SIZE &&
+	    l != DATAGRAM_PORT && l != DATAGRAM_USERS && l != JIT_CALLS &&
+	    l != JIT_LOOPS && l != PROFILE_ALLOC && l != PROFILE_RATE &&
+	    l != ARENA_SIZE && l != HUGE_PAGES) {
 	    char buffer[64];
 
 	    sprintf(buffer, "unspecified option %s", conf[l].name);
@@ -1271,6 +1337,12 @@ static bool conf_includes()
     cputs("# define ST_DATAGRAMPORTS 24\t/* datagram ports */\012");
     cputs("# define ST_TELNETPORTS\t25\t/* telnet ports */\012");
     cputs("# define ST_BINARYPORTS\t26\t/* binary ports */\012");
+    cputs("# define ST_PROFSAMPLES\t27\t/* # profiler samples */\012");
+    cputs("# define ST_OPCODES\t28\t/* instruction counters */\012");
+    cputs("# define ST_KFUNS\t29\t/* kfun counters */\012");
+    cputs("# define ST_CACHEHITS\t30\t/* # swap cache hits */\012");
+    cputs("# define ST_CACHEMISSES\t31\t/* # swap cache misses */\012");
+    cputs("# define ST_CACHEEVICT\t32\t/* # swap cache evictions */\012");
 
     cputs("\012# define O_COMPILETIME\t0\t/* time of compilation */\012");
     cputs("# define O_PROGSIZE\t1\t/* program size of object */\012");
@@ -1279,11 +1351,21 @@ static bool conf_includes()
     cputs("# define O_CALLOUTS\t4\t/* callouts in object */\012");
     cputs("# define O_INDEX\t5\t/* unique ID for master object */\012");
     cputs("# define O_UNDEFINED\t6\t/* undefined functions */\012");
+    cputs("# define O_CALLS\t7\t/* # calls to functions in program */\012");
+    cputs("# define O_LOOPS\t8\t/* # loop iterations in program */\012");
+    cputs("# define O_FUNCALLS\t9\t/* # calls per function */\012");
+    cputs("# define O_MEMORY\t10\t/* memory used by dataspace */\012");
 
     cputs("\012# define CO_HANDLE\t0\t/* callout handle */\012");
     cputs("# define CO_FUNCTION\t1\t/* function name */\012");
     cputs("# define CO_DELAY\t2\t/* delay */\012");
     cputs("# define CO_FIRSTXARG\t3\t/* first extra argument */\012");
+
+    cputs("\012# define OM_VARIABLES\t0\t/* memory used by variables */\012");
+    cputs("# define OM_ARRAYS\t1\t/* memory used by arrays */\012");
+    cputs("# define OM_MAPPINGS\t2\t/* memory used by mappings */\012");
+    cputs("# define OM_STRINGS\t3\t/* memory used by strings */\012");
+    cputs("# define OM_CALLOUTS\t4\t/* memory used by callouts */\012");
     if (!cclose()) {
 	return FALSE;
     }
@@ -1428,6 +1510,7 @@ static bool conf_includes()
 
 
 extern bool ext_dgd (char*, char*, void (**)(int*, int), void (**)());
+extern void ext_tiers(Uint, Uint);
 extern void ext_finish();
 
 /*
@@ -1487,6 +1570,8 @@ bool conf_init(char *configfile, char *snapshot, char *snapshot2, char *module,
     /* remove previously added kfuns */
     kf_clear();
 
+    ext_tiers((conf[JIT_CALLS].set) ? conf[JIT_CALLS].num : 100,
+	      (conf[JIT_LOOPS].set) ? conf[JIT_LOOPS].num : 10000);
     memset(mfdlist, '\0', MAX_STRINGS * sizeof(void (*)(int*, int)));
     memset(mfinish, '\0', MAX_STRINGS * sizeof(void (*)()));
     for (i = 0; modules[i] != NULL; i++) {
@@ -1570,7 +1655,9 @@ bool conf_init(char *configfile, char *snapshot, char *snapshot2, char *module,
     /* initialize swap device */
     cache = (Sector) ((conf[CACHE_SIZE].set) ? conf[CACHE_SIZE].num : 100);
     Swap::init(conf[SWAP_FILE].str, (Sector) conf[SWAP_SIZE].num, cache,
-	       (unsigned int) conf[SECTOR_SIZE].num);
+	       (unsigned int) conf[SECTOR_SIZE].num,
+	       (conf[CACHE_POLICY].set) ? (int) conf[CACHE_POLICY].num :
+					  SP_LRU);
 
     /* initialize swapped data handler */
     Dataspace::init();
@@ -1601,6 +1688,10 @@ bool conf_init(char *configfile, char *snapshot, char *snapshot2, char *module,
     /* initialize interpreter */
     Frame::init(conf[CREATE].str, conf[TYPECHECKING].num == 2);
 
+    /* initialize profiler */
+    Profile::init((conf[PROFILE_RATE].set) ? conf[PROFILE_RATE].num : 0,
+		  (conf[PROFILE_ALLOC].set) ? conf[PROFILE_ALLOC].num : 0);
+
     /* initialize compiler */
     c_init(conf[AUTO_OBJECT].str,
 	   conf[DRIVER_OBJECT].str,
@@ -1612,7 +1703,9 @@ bool conf_init(char *configfile, char *snapshot, char *snapshot2, char *module,
 
     /* initialize memory manager */
     Alloc::init((size_t) conf[STATIC_CHUNK].num,
-		(size_t) conf[DYNAMIC_CHUNK].num);
+		(size_t) conf[DYNAMIC_CHUNK].num,
+		(conf[ARENA_SIZE].set) ? (size_t) conf[ARENA_SIZE].num : 0,
+		(conf[HUGE_PAGES].set) ? (int) conf[HUGE_PAGES].num : 0);
 
     /*
      * create include files
@@ -1761,7 +1854,7 @@ bool conf_attach(int port)
  * NAME:	config->array_size()
  * DESCRIPTION:	return the maximum array size
  */
-unsigned short conf_array_size()
+asizet conf_array_size()
 {
     return conf[ARRAY_SIZE].num;
 }
@@ -1925,6 +2018,30 @@ bool conf_statusi(Frame *f, Int idx, Value *v)
 	}
 	break;
 
+    case 27:	/* ST_PROFSAMPLES */
+	PUT_INTVAL(v, Profile::samples());
+	break;
+
+    case 28:	/* ST_OPCODES */
+	Profile::opcodes(f->data, v);
+	break;
+
+    case 29:	/* ST_KFUNS */
+	Profile::kfuns(f->data, v);
+	break;
+
+    case 30:	/* ST_CACHEHITS */
+	PUT_INTVAL(v, Swap::info()->hits);
+	break;
+
+    case 31:	/* ST_CACHEMISSES */
+	PUT_INTVAL(v, Swap::info()->misses);
+	break;
+
+    case 32:	/* ST_CACHEEVICT */
+	PUT_INTVAL(v, Swap::info()->evictions);
+	break;
+
     default:
 	return FALSE;
     }
@@ -1944,8 +2061,8 @@ Array *conf_status(Frame *f)
 
     try {
 	ErrorContext::push();
-	a = Array::createNil(f->data, 27);
-	for (i = 0, v = a->elts; i < 27; i++, v++) {
+	a = Array::createNil(f->data, 33);
+	for (i = 0, v = a->elts; i < 33; i++, v++) {
 	    conf_statusi(f, i, v);
 	}
 	ErrorContext::pop();
@@ -2017,6 +2134,36 @@ bool conf_objecti(Dataspace *data, Object *obj, Int idx, Value *v)
 	}
 	break;
 
+    case 7:	/* O_CALLS */
+	PUT_INTVAL(v, ctrl->ncalls);
+	break;
+
+    case 8:	/* O_LOOPS */
+	PUT_INTVAL(v, ctrl->nloops);
+	break;
+
+    case 9:	/* O_FUNCALLS */
+	PUT_MAPVAL(v, ctrl->callCounts(data));
+	break;
+
+    case 10:	/* O_MEMORY */
+	{
+	    size_t mem[DM_SIZE];
+	    int i;
+
+	    if (obj->data != (Dataspace *) NULL) {
+		obj->data->memory(mem);
+	    } else {
+		memset(mem, '\0', sizeof(mem));	/* swapped out */
+	    }
+	    a = Array::create(data, DM_SIZE);
+	    for (i = 0; i < DM_SIZE; i++) {
+		putval(&a->elts[i], mem[i]);
+	    }
+	    PUT_ARRVAL(v, a);
+	}
+	break;
+
     default:
 	return FALSE;
     }
@@ -2034,10 +2181,10 @@ Array *conf_object(Dataspace *data, Object *obj)
     Int i;
     Array *a;
 
-    a = Array::createNil(data, 7);
+    a = Array::createNil(data, 11);
     try {
 	ErrorContext::push();
-	for (i = 0, v = a->elts; i < 7; i++, v++) {
+	for (i = 0, v = a->elts; i < 11; i++, v++) {
 	    conf_objecti(data, obj, i, v);
 	}
 	ErrorContext::pop();
@@ -18,15 +18,34 @@
  */
 
 /* these may be changed, but sizeof(type) <= sizeof(int) */
+# ifdef WIDEINDEX
+typedef Uint uindex;
+# define UINDEX_MAX	UINT_MAX
+# else
 typedef unsigned short uindex;
 # define UINDEX_MAX	USHRT_MAX
+# endif
 
 typedef uindex Sector;
 # define SW_UNUSED	UINDEX_MAX
 
 /* sizeof(ssizet) <= sizeof(uindex) */
+# ifdef WIDEINDEX
+typedef Uint ssizet;
+# define SSIZET_MAX	UINT_MAX
+# else
 typedef unsigned short ssizet;
 # define SSIZET_MAX	USHRT_MAX
+# endif
+
+/* sizeof(asizet) <= sizeof(Uint) */
+# ifdef WIDEINDEX
+typedef Uint asizet;
+# define ASIZET_MAX	UINT_MAX
+# else
+typedef unsigned short asizet;
+# define ASIZET_MAX	USHRT_MAX
+# endif
 
 /* eindex can be anything */
 typedef unsigned char eindex;
@@ -46,7 +65,6 @@ typedef unsigned short kfindex;
 # define BUF_SIZE	FS_BLOCK_SIZE	/* I/O buffer size */
 # define MAX_LINE_SIZE	4096	/* max. line size in ed and lex (power of 2) */
 # define STRINGSZ	256	/* general (internal) string size */
-# define STRMAPHASHSZ	20	/* # characters to hash of map string indices */
 # define STRMERGETABSZ	1024	/* general string merge table size */
 # define STRMERGEHASHSZ	20	/* # characters in merge strings to hash */
 # define ARRMERGETABSZ	1024	/* general array merge table size */
@@ -104,7 +122,7 @@ extern char	       *conf_base_dir	();
 extern char	       *conf_driver	();
 extern char	      **conf_hotboot	();
 extern int		conf_typechecking ();
-extern unsigned short	conf_array_size	();
+extern asizet		conf_array_size	();
 extern bool		conf_attach	(int);
 
 extern void   conf_dump		(bool, bool);
@@ -29,9 +29,15 @@
 # include "parse.h"
 
 
+# ifdef COMPACTVALUE
+Value Value::zeroInt(T_INT, TRUE);
+Value Value::zeroFloat(T_FLOAT, TRUE);
+Value Value::nil(T_NIL, TRUE);
+# else
 Value Value::zeroInt = { T_INT, TRUE };
 Value Value::zeroFloat = { T_FLOAT, TRUE };
 Value Value::nil = { T_NIL, TRUE };
+# endif
 
 /*
  * initialize nil value
@@ -729,12 +735,14 @@ void Dataplane::discard(Int level)
 	data = p->alocal.data;
 	if (p->original != (Value *) NULL) {
 	    /* restore original variable values */
+	    data->memUsed[DM_STRINGS] -= data->varStrings();
 	    for (v = data->variables, i = data->nvariables; i != 0; --i, v++) {
 		v->del();
 	    }
-	    memcpy(data->variables, p->original,
+	    memcpy((void *) data->variables, p->original,
 		   data->nvariables * sizeof(Value));
 	    FREE(p->original);
+	    data->memUsed[DM_STRINGS] += data->varStrings();
 	}
 
 	if (p->coptab != (COPTable *) NULL) {
@@ -892,6 +900,9 @@ Dataspace::Dataspace(Object *obj) : base(this)
 
     /* parse_string data */
     parser = (struct parser *) NULL;
+
+    /* memory accounting */
+    memset(memUsed, '\0', sizeof(memUsed));
 }
 
 /*
@@ -1035,6 +1046,8 @@ void Dataspace::freeValues()
 	alist.next->freelist();
 	alist.prev = alist.next = &alist;
     }
+
+    memset(memUsed, '\0', sizeof(memUsed));
 }
 
 /*
@@ -1184,10 +1197,10 @@ struct SArray {
     Uint tag;			/* unique value for each array */
     Uint ref;			/* refcount */
     char type;			/* array type */
-    unsigned short size;	/* size of array */
+    asizet size;		/* size of array */
 };
 
-static char sa_layout[] = "iics";
+static char sa_layout[] = "iica";
 
 struct SArray0 {
     Uint index;			/* index in array value table */
@@ -1569,6 +1582,8 @@ Array *Dataspace::array(Uint idx)
 	arr->next = alist.next;
 	arr->next->prev = arr;
 	alist.next = arr;
+	arr->mapping = (sarrays[idx].type == T_MAPPING);
+	arr->charge();
 	return arr;
     }
     return plane->arrays[idx].arr;
@@ -1595,7 +1610,14 @@ void Dataspace::loadValues(SValue *sv, Value *v, int n)
 	    v->string->ref();
 	    break;
 
+# ifdef NATIVEFLOAT
 	case T_FLOAT:
+	    v->fbits = FLOAT_BITS(sv->oindex, sv->objcnt);
+	    break;
+
+# else
+	case T_FLOAT:
+# endif
 	case T_OBJECT:
 	    v->oindex = sv->oindex;
 	    v->objcnt = sv->objcnt;
@@ -1623,7 +1645,7 @@ void Dataspace::newVars(Control *ctrl, Value *val)
     char *type;
     VarDef *var;
 
-    memset(val, '\0', ctrl->nvariables * sizeof(Value));
+    memset((void *) val, '\0', ctrl->nvariables * sizeof(Value));
     for (n = ctrl->nvariables - ctrl->nvardefs, type = ctrl->varTypes();
 	 n != 0; --n, type++) {
 	val->type = *type;
@@ -1670,6 +1692,7 @@ Value *Dataspace::variable(unsigned int idx)
 		loadVars(Swap::readv);
 	    }
 	    loadValues(svariables, variables, nvariables);
+	    memUsed[DM_STRINGS] += varStrings();
 	}
     }
 
@@ -1718,6 +1741,7 @@ Value *Dataspace::elts(Array *arr)
 	v = arr->elts = ALLOC(Value, arr->size);
 	idx = data->saindex[arr->primary - data->plane->arrays];
 	data->loadValues(&data->selts[idx], v, arr->size);
+	arr->charge();
     }
 
     return v;
@@ -1782,6 +1806,7 @@ public:
 	Object *obj;
 	Value *elts;
 	Uint count;
+	Float flt;
 
 	while (n > 0) {
 	    switch (v->type) {
@@ -1814,12 +1839,13 @@ public:
 		    count = obj->count;
 		    if (elts[1].type == T_INT) {
 			/* convert to new LWO type */
-			elts[1].type = T_FLOAT;
-			elts[1].oindex = FALSE;
+			flt.high = FALSE;
+			flt.low = elts[1].number;
+			PUT_FLTVAL(&elts[1], flt);
 		    }
+		    GET_FLT(&elts[1], flt);
 		    if (v->array->put(narr) == narr) {
-			if (elts->objcnt == count &&
-			    elts[1].objcnt != obj->update) {
+			if (elts->objcnt == count && flt.low != obj->update) {
 			    Dataspace::upgradeLWO(v->array, obj);
 			}
 			arrCount(v->array);
@@ -1838,7 +1864,7 @@ public:
     /*
      * save the values in an object
      */
-    void save(SValue *sv, Value *v, unsigned short n) {
+    void save(SValue *sv, Value *v, asizet n) {
 	Uint i;
 
 	while (n > 0) {
@@ -1866,7 +1892,15 @@ public:
 		}
 		break;
 
+# ifdef NATIVEFLOAT
+	    case T_FLOAT:
+		sv->oindex = FLOAT_HIGH(v->fbits);
+		sv->objcnt = FLOAT_LOW(v->fbits);
+		break;
+
+# else
 	    case T_FLOAT:
+# endif
 	    case T_OBJECT:
 		sv->oindex = v->oindex;
 		sv->objcnt = v->objcnt;
@@ -1918,7 +1952,7 @@ private:
 /*
  * save modified values as svalues
  */
-void Dataspace::saveValues(SValue *sv, Value *v, unsigned short n)
+void Dataspace::saveValues(SValue *sv, Value *v, asizet n)
 {
     while (n > 0) {
 	if (v->modified) {
@@ -1939,7 +1973,15 @@ void Dataspace::saveValues(SValue *sv, Value *v, unsigned short n)
 		sv->string = v->string->primary - base.strings;
 		break;
 
+# ifdef NATIVEFLOAT
 	    case T_FLOAT:
+		sv->oindex = FLOAT_HIGH(v->fbits);
+		sv->objcnt = FLOAT_LOW(v->fbits);
+		break;
+
+# else
+	    case T_FLOAT:
+# endif
 	    case T_OBJECT:
 		sv->oindex = v->oindex;
 		sv->objcnt = v->objcnt;
@@ -2438,6 +2480,9 @@ void Dataspace::refRhs(Value *rhs)
 	arr = rhs->array;
 	if (arr->primary->data == this) {
 	    /* in this object */
+	    if (arr->memory == 0) {
+		arr->charge();
+	    }
 	    if (arr->primary->arr != (Array *) NULL) {
 		/* swapped in */
 		arr->primary->ref++;
@@ -2525,7 +2570,7 @@ void Dataspace::delLhs(Value *lhs)
 void Dataspace::refImports(Array *arr)
 {
     Dataspace *data;
-    unsigned short n;
+    asizet n;
     Value *v;
 
     data = arr->primary->data;
@@ -2559,6 +2604,8 @@ void Dataspace::assignVar(Value *var, Value *val)
 	    Value::copy(plane->original = ALLOC(Value, nvariables), variables,
 			nvariables);
 	}
+	memUsed[DM_STRINGS] += STRMEM(val);
+	memUsed[DM_STRINGS] -= STRMEM(var);
 	refRhs(val);
 	delLhs(var);
 	plane->flags |= MOD_VARIABLE;
@@ -2609,6 +2656,19 @@ void Dataspace::wipeExtra(Dataspace *data)
 void Dataspace::assignElt(Array *arr, Value *elt, Value *val)
 {
     Dataspace *data;
+    asizet n;
+
+    if (arr->shared != (Array *) NULL) {
+	/*
+	 * a slice gets its own elements before it is modified
+	 */
+	n = elt - arr->elts;
+	arr->unshare();
+	elt = arr->elts + n;
+    } else if (arr->nslices != 0) {
+	/* slices of this array keep the original elements */
+	arr->unshare();
+    }
 
     if (plane->level != arr->primary->data->plane->level) {
 	/*
@@ -2660,6 +2720,21 @@ void Dataspace::assignElt(Array *arr, Value *elt, Value *val)
 	}
     }
 
+    if (arr->memory != 0) {
+	/*
+	 * update the memory charged for the array
+	 */
+	if (T_INDEXED(val->type)) {
+	    if (val->array->memory == 0 && val->array->primary->data == data) {
+		val->array->charge();
+	    }
+	}
+	arr->strMemory += STRMEM(val);
+	arr->strMemory -= STRMEM(elt);
+	data->memUsed[DM_STRINGS] += STRMEM(val);
+	data->memUsed[DM_STRINGS] -= STRMEM(elt);
+    }
+
     val->ref();
     elt->del();
 
@@ -2750,7 +2825,7 @@ uindex Dataspace::allocCallOut(uindex handle, Uint time, unsigned short mtime,
     co->time = time;
     co->mtime = mtime;
     co->nargs = nargs;
-    memcpy(co->val, v, sizeof(co->val));
+    memcpy((void *) co->val, v, sizeof(co->val));
     switch (nargs) {
     default:
 	refRhs(&v[3]);
@@ -2843,7 +2918,8 @@ uindex Dataspace::newCallOut(String *func, Int delay, unsigned int mdelay,
 	v[1] = f->sp[0];
 	v[2] = f->sp[1];
 	PUT_ARRVAL(&v[3], Array::create(this, nargs - 2));
-	memcpy(v[3].array->elts, f->sp + 2, (nargs - 2) * sizeof(Value));
+	memcpy((void *) v[3].array->elts, f->sp + 2,
+	       (nargs - 2) * sizeof(Value));
 	refImports(v[3].array);
 	break;
     }
@@ -2997,7 +3073,7 @@ String *Dataspace::callOut(unsigned int handle, Frame *f, int *nargs)
     default:
 	n = co->nargs - 2;
 	f->sp -= n;
-	memcpy(f->sp, elts(v[3].array), n * sizeof(Value));
+	memcpy((void *) f->sp, elts(v[3].array), n * sizeof(Value));
 	delLhs(&v[3]);
 	FREE(v[3].array->elts);
 	v[3].array->elts = (Value *) NULL;
@@ -3136,6 +3212,102 @@ Array *Dataspace::listCallouts(Dataspace *data)
 }
 
 
+/*
+ * return the string memory held by the variables
+ */
+Uint Dataspace::varStrings()
+{
+    Value *v;
+    unsigned short n;
+    Uint mem;
+
+    mem = 0;
+    for (v = variables, n = nvariables; n != 0; v++, --n) {
+	mem += STRMEM(v);
+    }
+    return mem;
+}
+
+/*
+ * return the memory used by a dataspace, by category
+ */
+size_t Dataspace::memory(size_t *mem)
+{
+    size_t total;
+    int i;
+
+    memcpy(mem, memUsed, sizeof(memUsed));
+    mem[DM_VARIABLES] = (variables != (Value *) NULL) ?
+			 nvariables * sizeof(Value) : 0;
+    mem[DM_CALLOUTS] = (callouts != (DCallOut *) NULL) ?
+			ncallouts * sizeof(DCallOut) : 0;
+    for (total = 0, i = 0; i < DM_SIZE; i++) {
+	total += mem[i];
+    }
+    return total;
+}
+
+struct MemUse {
+    size_t memory;			/* memory used */
+    uindex oindex;			/* object */
+};
+
+/*
+ * NAME:	cmpmem()
+ * DESCRIPTION:	compare memory use, largest first
+ */
+static int cmpmem(cvoid *cv1, cvoid *cv2)
+{
+    size_t m1, m2;
+
+    m1 = ((MemUse *) cv1)->memory;
+    m2 = ((MemUse *) cv2)->memory;
+    return (m1 > m2) ? -1 : (m1 < m2);
+}
+
+/*
+ * return the number of dataspaces in memory
+ */
+Sector Dataspace::dcount()
+{
+    return ndata;
+}
+
+/*
+ * return the n objects with dataspaces in memory that use the most
+ */
+Array *Dataspace::memoryTop(Dataspace *data, Int n)
+{
+    size_t mem[DM_SIZE];
+    MemUse *tab;
+    Dataspace *d;
+    Uint i;
+    Array *a;
+    Value *v;
+
+    tab = ALLOC(MemUse, ndata + 1);
+    for (i = 0, d = dhead; d != (Dataspace *) NULL; d = d->next) {
+	if (OBJ(d->oindex)->count != 0) {
+	    tab[i].memory = d->memory(mem);
+	    tab[i].oindex = d->oindex;
+	    i++;
+	}
+    }
+    qsort(tab, i, sizeof(MemUse), cmpmem);
+
+    if ((Uint) n > i) {
+	n = i;
+    }
+    a = Array::create(data, n);
+    for (v = a->elts, i = 0; i < (Uint) n; v++, i++) {
+	PUT_OBJVAL(v, OBJ(tab[i].oindex));
+    }
+    FREE(tab);
+
+    return a;
+}
+
+
 /*
  * get the variable mapping for an object
  */
@@ -3215,6 +3387,7 @@ void Dataspace::upgrade(unsigned int nvar, unsigned short *vmap, Object *tmpl)
     vars = v - nvar;
 
     /* deref old values */
+    memUsed[DM_STRINGS] -= varStrings();
     v = variables;
     for (n = nvariables; n > 0; --n) {
 	delLhs(v);
@@ -3234,6 +3407,7 @@ void Dataspace::upgrade(unsigned int nvar, unsigned short *vmap, Object *tmpl)
 	nvariables = nvar;
 	base.achange++;	/* force rebuild on swapout */
     }
+    memUsed[DM_STRINGS] += varStrings();
 
     OBJ(oindex)->upgraded(tmpl);
 }
@@ -3271,17 +3445,21 @@ Object *Dataspace::upgradeLWO(Array *lwobj, Object *obj)
     Uint update;
     unsigned short nvar, *vmap;
     Value *vars;
+    Float flt;
 
     a = lwobj->primary;
     update = obj->update;
-    vmap = varmap(&obj, (Uint) lwobj->elts[1].number, &nvar);
+    GET_FLT(&lwobj->elts[1], flt);
+    vmap = varmap(&obj, flt.low, &nvar);
     --nvar;
 
     /* map variables */
     v = ALLOC(Value, nvar + 2);
     *v++ = lwobj->elts[0];
     *v = lwobj->elts[1];
-    (v++)->objcnt = update;
+    flt.low = update;
+    PUT_FLT(v, flt);
+    v++;
 
     vars = lwobj->elts + 2;
     for (n = nvar; n > 0; --n) {
@@ -3344,6 +3522,9 @@ Object *Dataspace::upgradeLWO(Array *lwobj, Object *obj)
     lwobj->size = nvar + 2;
     FREE(lwobj->elts);
     lwobj->elts = vars;
+    if (lwobj->memory != 0) {
+	lwobj->charge();
+    }
 
     return obj;
 }
@@ -3357,7 +3538,7 @@ struct ArrImport {
 /*
  * copy imported arrays to current dataspace
  */
-void Dataspace::import(ArrImport *imp, Value *val, unsigned short n)
+void Dataspace::import(ArrImport *imp, Value *val, asizet n)
 {
     Array *import, *a;
 
@@ -3387,6 +3568,9 @@ void Dataspace::import(ArrImport *imp, Value *val, unsigned short n)
 			    /*
 			     * move array to new dataspace
 			     */
+			    if (a->memory != 0) {
+				a->discharge();
+			    }
 			    a->prev->next = a->next;
 			    a->next->prev = a->prev;
 			} else {
@@ -3394,6 +3578,7 @@ void Dataspace::import(ArrImport *imp, Value *val, unsigned short n)
 			     * make new array
 			     */
 			    a = Array::alloc(a->size);
+			    a->mapping = val->array->mapping;
 			    a->tag = val->array->tag;
 			    a->objDestrCount = val->array->objDestrCount;
 
@@ -3429,6 +3614,7 @@ void Dataspace::import(ArrImport *imp, Value *val, unsigned short n)
 			}
 
 			a->primary = &base.alocal;
+			a->charge();
 			if (a->size == 0) {
 			    /*
 			     * put empty array in dataspace
@@ -31,6 +31,121 @@ struct ArrRef {
     Uint ref;			/* # of refs */
 };
 
+# if defined(COMPACTVALUE) && defined(NATIVEFLOAT)
+# error NATIVEFLOAT requires the full value layout
+# endif
+# if defined(COMPACTVALUE) && defined(WIDEINDEX)
+# error WIDEINDEX requires the full value layout
+# endif
+
+# ifdef COMPACTVALUE
+/*
+ * A value packed in 64 bits: the type in the top byte, the dirty bit in the
+ * byte below that, and the object index, number or pointer in the low 48
+ * bits.  The fields are accessed through proxies, so that code can use them
+ * as if they were ordinary members.
+ */
+template <class T, int SHIFT, int BITS> struct ValueField {
+    Uuint bits;
+
+    operator T() const {
+	return (T) ((bits >> SHIFT) & (((Uuint) 1 << BITS) - 1));
+    }
+    ValueField &operator=(T val) {
+	bits = (bits & ~((((Uuint) 1 << BITS) - 1) << SHIFT)) |
+	       (((Uuint) val & (((Uuint) 1 << BITS) - 1)) << SHIFT);
+	return *this;
+    }
+    ValueField &operator=(const ValueField &field) {
+	return *this = (T) field;
+    }
+    ValueField &operator+=(T val)	{ return *this = (T) (*this + val); }
+    ValueField &operator-=(T val)	{ return *this = (T) (*this - val); }
+    ValueField &operator*=(T val)	{ return *this = (T) (*this * val); }
+    ValueField &operator/=(T val)	{ return *this = (T) (*this / val); }
+    ValueField &operator%=(T val)	{ return *this = (T) (*this % val); }
+    ValueField &operator&=(T val)	{ return *this = (T) (*this & val); }
+    ValueField &operator|=(T val)	{ return *this = (T) (*this | val); }
+    ValueField &operator^=(T val)	{ return *this = (T) (*this ^ val); }
+    ValueField &operator<<=(int n)	{ return *this = (T) (*this << n); }
+    ValueField &operator>>=(int n)	{ return *this = (T) (*this >> n); }
+    ValueField &operator++()		{ return *this += 1; }
+    ValueField &operator--()		{ return *this -= 1; }
+    T operator++(int) {
+	T val;
+
+	val = *this;
+	*this += 1;
+	return val;
+    }
+    T operator--(int) {
+	T val;
+
+	val = *this;
+	*this -= 1;
+	return val;
+    }
+};
+
+template <class T> struct ValuePointer {
+    Uuint bits;
+
+    operator T*() const {
+	return (T *) (uintptr_t) (bits & (((Uuint) 1 << 48) - 1));
+    }
+    T *operator->() const {
+	return (T *) *this;
+    }
+    ValuePointer &operator=(T *ptr) {
+	bits = (bits & ~(((Uuint) 1 << 48) - 1)) | (Uuint) (uintptr_t) ptr;
+	return *this;
+    }
+    ValuePointer &operator=(const ValuePointer &field) {
+	return *this = (T *) field;
+    }
+};
+
+class Value {
+public:
+    Value() { }
+    Value(const Value &val) {
+	bits = val.bits;
+    }
+    Value(char type, bool modified) {
+	bits = 0;
+	this->type = type;
+	this->modified = modified;
+    }
+
+    Value &operator=(const Value &val) {
+	bits = val.bits;
+	return *this;
+    }
+
+    void ref();
+    void del();
+    static void copy(Value*, Value*, unsigned int);
+    static char *typeName(char *buf, unsigned int type);
+
+    static void init(bool stricttc);
+
+    union {
+	Uuint bits;					/* packed value */
+	ValueField<char, 56, 8> type;			/* value type */
+	ValueField<bool, 48, 8> modified;		/* dirty bit */
+	ValueField<uindex, 32, 8 * sizeof(uindex)> oindex; /* object index */
+	ValueField<Int, 0, 32> number;			/* number */
+	ValueField<Uint, 0, 32> objcnt;			/* object count */
+	ValuePointer<String> string;			/* string */
+	ValuePointer<Array> array;			/* array or mapping */
+    };
+
+    static Value zeroInt, zeroFloat, nil;
+};
+
+# define VAL_MODIFIED(v)	((v)->bits & ((Uuint) 0xff << 48))
+# define VAL_BITS(t, x)		(((Uuint) (t) << 56) | (Uuint) (x))
+# else
 class Value {
 public:
     void ref();
@@ -48,10 +163,15 @@ public:
 	Uint objcnt;		/* object creation count */
 	String *string;		/* string */
 	Array *array;		/* array or mapping */
+# ifdef NATIVEFLOAT
+	double flt;		/* float */
+	Uuint fbits;		/* float as stored */
+# endif
     };
 
     static Value zeroInt, zeroFloat, nil;
 };
+# endif
 
 # define T_TYPE		0x0f	/* type mask */
 # define T_NIL		0x00
@@ -83,8 +203,13 @@ public:
 # define TNBUFSIZE	24
 
 # define VAL_NIL(v)	((v)->type == Value::nil.type && (v)->number == 0)
+# ifdef NATIVEFLOAT
+# define VAL_TRUE(v)	((v)->number != 0 || (v)->type > T_FLOAT ||	\
+			 ((v)->type == T_FLOAT && ((v)->fbits >> 48) != 0))
+# else
 # define VAL_TRUE(v)	((v)->number != 0 || (v)->type > T_FLOAT ||	\
 			 ((v)->type == T_FLOAT && (v)->oindex != 0))
+# endif
 
 struct DCallOut {
     Uint time;			/* time of call */
@@ -93,6 +218,16 @@ struct DCallOut {
     Value val[4];		/* function name, 3 direct arguments */
 };
 
+# define DM_VARIABLES	0	/* variables */
+# define DM_ARRAYS	1	/* arrays and light-weight objects */
+# define DM_MAPPINGS	2	/* mappings */
+# define DM_STRINGS	3	/* strings in variables and elements */
+# define DM_CALLOUTS	4	/* callouts */
+# define DM_SIZE	5
+
+# define STRMEM(v)	(((v)->type == T_STRING) ?			\
+			 (Uint) sizeof(String) + (v)->string->len : 0)
+
 class Dataplane : public Allocated {
 public:
     Dataplane(Dataspace *data);
@@ -146,6 +281,8 @@ public:
     Int delCallOut(Uint handle, unsigned short *mtime);
     String *callOut(unsigned int handle, Frame *f, int *nargs);
     Array *listCallouts(Dataspace *data);
+    Uint varStrings();
+    size_t memory(size_t *mem);
     void upgrade(unsigned int nvar, unsigned short *vmap, Object *tmpl);
 
     static Dataspace *create(Object *obj);
@@ -160,6 +297,8 @@ public:
     static void setExtra(Dataspace *data, Value *val);
     static void wipeExtra(Dataspace *data);
     static Object *upgradeLWO(Array *lwobj, Object *obj);
+    static Sector dcount();
+    static Array *memoryTop(Dataspace *data, Int n);
     static void xport();
     static void init();
     static void initConv(bool c14);
@@ -191,6 +330,8 @@ public:
     Dataplane *plane;		/* current value plane */
     Dataplane base;		/* basic value plane */
 
+    size_t memUsed[DM_SIZE];	/* memory charged, by category */
+
 private:
     Dataspace(Object *obj);
     virtual ~Dataspace();
@@ -205,13 +346,13 @@ private:
     void loadElts(void (*readv) (char*, Sector*, Uint, Uint));
     void _loadCallouts(void (*readv) (char*, Sector*, Uint, Uint));
     void loadCallouts();
-    void saveValues(struct SValue *sv, Value *v, unsigned short n);
+    void saveValues(struct SValue *sv, Value *v, asizet n);
     bool save(bool swap);
     void fix(Uint *counttab);
     void refRhs(Value *rhs);
     void delLhs(Value *lhs);
     void upgradeClone();
-    void import(struct ArrImport *imp, Value *val, unsigned short n);
+    void import(struct ArrImport *imp, Value *val, asizet n);
 
     static Dataspace *_load(Object *obj,
 			    void (*readv) (char*, Sector*, Uint, Uint));
@@ -30,6 +30,7 @@
 # include "comm.h"
 # include "node.h"
 # include "compile.h"
+# include "profile.h"
 # include <stdarg.h>
 
 static uindex dindex;		/* driver object index */
@@ -81,7 +82,9 @@ extern void ext_finish();
  */
 void endtask()
 {
+    Profile::flush();
     Comm::flush();
+    Array::unshareAll();
     Dataspace::xport();
     Object::clean();
     Frame::clear();
@@ -122,6 +125,7 @@ void endtask()
     }
 
     if (Object::stop) {
+	Profile::finish();
 	Swap::finish();
 	conf_mod_finish();
 	ext_finish();
@@ -183,7 +183,7 @@ String *Editor::command(Object *obj, char *cmd)
 	if (!internal) {
 	    error((char *) NULL);	/* pass on error */
 	}
-	output("%s\012", ErrorContext::exception()->text);	/* LF */
+	output("%s\012", (char *) ErrorContext::exception()->text);	/* LF */
     }
 
     if (outbufsz == 0) {
@@ -249,7 +249,7 @@ void message(const char *format, ...)
 	}
 # endif
 	if (ErrorContext::exception()->len <= sizeof(ebuf) - 2) {
-	    sprintf(ebuf, "%s\012", ErrorContext::exception()->text);
+	    sprintf(ebuf, "%s\012", (char *) ErrorContext::exception()->text);
 	} else {
 	    strcpy(ebuf, "[too long error string]\012");
 	}
@@ -25,6 +25,7 @@
 # include "data.h"
 # include "control.h"
 # include "interpret.h"
+# include "profile.h"
 # include "comm.h"
 # include "table.h"
 # include <float.h>
@@ -131,6 +132,33 @@ static void ext_int_putval(Value *val, Int i)
 }
 
 # ifndef NOFLOAT
+# ifdef NATIVEFLOAT
+/*
+ * NAME:	ext->float_getval()
+ * DESCRIPTION:	retrieve a float from a value
+ */
+static long double ext_float_getval(Value *val)
+{
+    return (long double) val->flt;
+}
+
+/*
+ * NAME:	ext->float_putval()
+ * DESCRIPTION:	store a float in a value
+ */
+static int ext_float_putval(Value *val, long double ld)
+{
+    double d;
+
+    d = (double) ld;
+    if (!Float::narrow(&d)) {
+	return FALSE;
+    }
+    val->flt = d;
+    val->type = T_FLOAT;
+    return TRUE;
+}
+# else
 /*
  * NAME:	ext->float_getval()
  * DESCRIPTION:	retrieve a float from a value
@@ -193,6 +221,7 @@ static int ext_float_putval(Value *val, long double ld)
     return TRUE;
 }
 # endif
+# endif
 
 /*
  * NAME:	ext->string_getval()
@@ -910,7 +939,7 @@ static void ext_vm_stores_cast(Frame *f, uint8_t type,
 			       uint16_t inherit, uint16_t index)
 {
     try {
-	if (f->nStores <= f->sp->array->size) {
+	if (f->nStores <= (int) f->sp->array->size) {
 	    f->cast(&f->sp->array->elts[f->nStores - 1], type,
 		    ((Uint) inherit << 16) + index);
 	}
@@ -924,7 +953,7 @@ static void ext_vm_stores_cast(Frame *f, uint8_t type,
  */
 static void ext_vm_stores_param(Frame *f, uint8_t param)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeParam(param, &f->sp->array->elts[f->nStores]);
     }
 }
@@ -934,7 +963,7 @@ static void ext_vm_stores_param(Frame *f, uint8_t param)
  */
 static Int ext_vm_stores_param_int(Frame *f, uint8_t param)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeParam(param, &f->sp->array->elts[f->nStores]);
     }
     return f->argp[param].number;
@@ -945,7 +974,7 @@ static Int ext_vm_stores_param_int(Frame *f, uint8_t param)
  */
 static double ext_vm_stores_param_float(Frame *f, uint8_t param)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeParam(param, &f->sp->array->elts[f->nStores]);
     }
     return ext_float_getval(f->argp + param);
@@ -956,7 +985,7 @@ static double ext_vm_stores_param_float(Frame *f, uint8_t param)
  */
 static void ext_vm_stores_local(Frame *f, uint8_t local)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeLocal(local, &f->sp->array->elts[f->nStores]);
     }
 }
@@ -966,7 +995,7 @@ static void ext_vm_stores_local(Frame *f, uint8_t local)
  */
 static Int ext_vm_stores_local_int(Frame *f, uint8_t local, Int n)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeLocal(local, &f->sp->array->elts[f->nStores]);
 	return (f->fp - local)->number;
     }
@@ -978,7 +1007,7 @@ static Int ext_vm_stores_local_int(Frame *f, uint8_t local, Int n)
  */
 static double ext_vm_stores_local_float(Frame *f, uint8_t local, double flt)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeLocal(local, &f->sp->array->elts[f->nStores]);
 	return ext_float_getval(f->fp - local);
     }
@@ -990,7 +1019,7 @@ static double ext_vm_stores_local_float(Frame *f, uint8_t local, double flt)
  */
 static void ext_vm_stores_global(Frame *f, uint16_t inherit, uint8_t index)
 {
-    if (--(f->nStores) < f->sp->array->size) {
+    if (--(f->nStores) < (int) f->sp->array->size) {
 	f->storeGlobal(inherit, index, &f->sp->array->elts[f->nStores]);
     }
 }
@@ -1001,7 +1030,7 @@ static void ext_vm_stores_global(Frame *f, uint16_t inherit, uint8_t index)
 static void ext_vm_stores_index(Frame *f)
 {
     try {
-	if (--(f->nStores) < f->sp->array->size) {
+	if (--(f->nStores) < (int) f->sp->array->size) {
 	    f->storeIndex(&f->sp->array->elts[f->nStores]);
 	} else {
 	    f->storeSkip();
@@ -1017,7 +1046,7 @@ static void ext_vm_stores_index(Frame *f)
 static void ext_vm_stores_param_index(Frame *f, uint8_t param)
 {
     try {
-	if (--(f->nStores) < f->sp->array->size) {
+	if (--(f->nStores) < (int) f->sp->array->size) {
 	    f->storeParamIndex(param, &f->sp->array->elts[f->nStores]);
 	} else {
 	    f->storeSkip();
@@ -1033,7 +1062,7 @@ static void ext_vm_stores_param_index(Frame *f, uint8_t param)
 static void ext_vm_stores_local_index(Frame *f, uint8_t local)
 {
     try {
-	if (--(f->nStores) < f->sp->array->size) {
+	if (--(f->nStores) < (int) f->sp->array->size) {
 	    f->storeLocalIndex(local, &f->sp->array->elts[f->nStores]);
 	} else {
 	    f->storeSkip();
@@ -1050,7 +1079,7 @@ static void ext_vm_stores_global_index(Frame *f, uint16_t inherit,
 				       uint8_t index)
 {
     try {
-	if (--(f->nStores) < f->sp->array->size) {
+	if (--(f->nStores) < (int) f->sp->array->size) {
 	    f->storeGlobalIndex(inherit, index,
 				&f->sp->array->elts[f->nStores]);
 	} else {
@@ -1067,7 +1096,7 @@ static void ext_vm_stores_global_index(Frame *f, uint16_t inherit,
 static void ext_vm_stores_index_index(Frame *f)
 {
     try {
-	if (--(f->nStores) < f->sp->array->size) {
+	if (--(f->nStores) < (int) f->sp->array->size) {
 	    f->storeIndexIndex(&f->sp->array->elts[f->nStores]);
 	} else {
 	    f->storeSkipSkip();
@@ -1678,6 +1707,7 @@ static void (*jit_compile)(uint64_t, uint64_t, int, uint8_t*, size_t, int,
 			   uint8_t*, size_t, uint8_t*, size_t);
 static int (*jit_execute)(uint64_t, uint64_t, int, int, void*);
 static void (*jit_release)(uint64_t, uint64_t);
+static Uint jit_calls, jit_loops;	/* thresholds for JIT compilation */
 
 /*
  * NAME:        ext->jit()
@@ -1871,6 +1901,17 @@ static void ext_compile(const Frame *f, Control *ctrl)
     AFREE(vtypes);
 }
 
+/*
+ * NAME:	ext->tiers()
+ * DESCRIPTION:	set the number of calls or loop iterations after which a
+ *		program is JIT-compiled
+ */
+void ext_tiers(Uint calls, Uint loops)
+{
+    jit_calls = calls;
+    jit_loops = loops;
+}
+
 /*
  * NAME:	ext->execute()
  * DESCRIPTION:	JIT-compile and execute a function
@@ -1880,13 +1921,18 @@ bool ext_execute(const Frame *f, int func)
     Control *ctrl;
     int result;
 
+    ctrl = f->p_ctrl;
+    ctrl->countCall(func);
     if (jit_compile == NULL) {
 	return FALSE;
     }
-    ctrl = f->p_ctrl;
     if (ctrl->instance == 0) {
 	return FALSE;
     }
+    if (!(OBJR(ctrl->oindex)->flags & O_COMPILED) &&
+	ctrl->ncalls < jit_calls && ctrl->nloops < jit_loops) {
+	return FALSE;	/* not hot enough to compile yet */
+    }
 
     if (!setjmp(*ErrorContext::push())) {
 	result = (*jit_execute)(ctrl->oindex, ctrl->instance, ctrl->version,
@@ -60,6 +60,9 @@ typedef unsigned int Uint;
 
 # define Uuint			unsigned __int64
 
+# include <intrin.h>
+# define CALLSITE()		_ReturnAddress()
+
 typedef int (__stdcall _voidf_)();
 # define voidf			_voidf_
 
@@ -294,6 +297,11 @@ extern void  P_closedir	();
 # endif
 
 extern voidf *P_dload	(char*, const char*);
+extern char  *P_daddr	(void*, char*);
+
+extern void *P_mmap	(size_t, int);
+extern void  P_munmap	(void*, size_t);
+extern void  P_mrelease	(void*, size_t);
 
 extern void  P_srandom	(long);
 extern long  P_random	();
@@ -301,6 +309,8 @@ extern long  P_random	();
 extern Uint  P_time	();
 extern Uint  P_mtime	(unsigned short*);
 extern char *P_ctime	(char*, Uint);
+extern void  P_profile	(Uint, void (*)());
+extern Uuint P_cycles	();
 
 /* these must be the same on all hosts */
 # define BEL	'\007'
@@ -323,4 +333,12 @@ struct _struct_al_ { jmp_buf buf; short s; };
 #  define UNREFERENCED_PARAMETER(P)	(void)(P)
 # endif
 
+# ifndef CALLSITE
+#  ifdef __GNUC__
+#   define CALLSITE()	__builtin_return_address(0)
+#  else
+#   define CALLSITE()	((void *) NULL)
+#  endif
+# endif
+
 typedef const void cvoid;
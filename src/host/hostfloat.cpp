@@ -48,6 +48,75 @@ static void f_erange()
     error("Result too large");
 }
 
+# ifdef NATIVEFLOAT
+# if (DBL_MANT_DIG != 53 || DBL_MAX_EXP != 1024)
+# error NATIVEFLOAT requires IEEE doubles
+# endif
+
+# define EXPMASK		((Uuint) 0x7ff0 << 48)
+
+union FloatBits {
+    double d;
+    Uuint bits;
+};
+
+/*
+ * NAME:	Float::narrow()
+ * DESCRIPTION:	round a double to Float precision, in place.  Return FALSE
+ *		if the result is out of range.
+ */
+bool Float::narrow(double *d)
+{
+    FloatBits u;
+
+    u.d = *d;
+    if ((u.bits & EXPMASK) == 0) {
+	*d = 0.0;		/* zero or denormal */
+	return TRUE;
+    }
+    if ((u.bits & EXPMASK) == EXPMASK) {
+	return FALSE;
+    }
+
+    /* round to nearest even at 36 bits of mantissa */
+    u.bits += 0x7fff + ((u.bits >> 16) & 1);
+    u.bits &= ~(Uuint) 0xffff;
+    if ((u.bits & EXPMASK) == EXPMASK) {
+	return FALSE;
+    }
+    *d = u.d;
+    return TRUE;
+}
+
+/*
+ * NAME:	f_get()
+ * DESCRIPTION:	retrieve a float from a value
+ */
+static double f_get(const Float *flt)
+{
+    FloatBits u;
+
+    u.bits = FLOAT_BITS(flt->high, flt->low);
+    return u.d;
+}
+
+/*
+ * NAME:	f_put()
+ * DESCRIPTION:	store a float in a value
+ */
+static bool f_put(Float *flt, double d)
+{
+    FloatBits u;
+
+    if (!Float::narrow(&d)) {
+	return FALSE;
+    }
+    u.d = d;
+    flt->high = FLOAT_HIGH(u.bits);
+    flt->low = FLOAT_LOW(u.bits);
+    return TRUE;
+}
+# else
 /*
  * NAME:	f_get()
  * DESCRIPTION:	retrieve a float from a value
@@ -105,6 +174,7 @@ static bool f_put(Float *flt, double d)
     }
     return TRUE;
 }
+# endif
 
 static const double tens[] = {
     1e+1L,
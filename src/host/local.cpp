@@ -0,0 +1,131 @@
+/*
+ * This file is part of DGD, https://github.com/dworkin/dgd
+ * Copyright (C) 1993-2010 Dworkin B.V.
+ * Copyright (C) 2010-2015 DGD Authors (see the commit log for details)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+# include "dgd.h"
+# include <signal.h>
+# include <sys/mman.h>
+
+# ifndef MAP_ANONYMOUS
+# define MAP_ANONYMOUS	MAP_ANON
+# endif
+
+# define HUGE_PAGE	(2 * 1024 * 1024)	/* common huge page size */
+
+extern "C" {
+
+/*
+ * NAME:	term()
+ * DESCRIPTION:	catch SIGTERM
+ */
+static void term(int arg)
+{
+    signal(SIGTERM, term);
+    interrupt();
+}
+
+}
+
+/*
+ * NAME:	main()
+ * DESCRIPTION:	main program
+ */
+int main(int argc, char *argv[])
+{
+    long seed;
+    unsigned short mtime;
+
+    seed = P_mtime(&mtime);
+    P_srandom(seed ^ ((long) mtime << 22));
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, term);
+    return dgd_main(argc, argv);
+}
+
+/*
+ * NAME:	P->message()
+ * DESCRIPTION:	show message
+ */
+void P_message(const char *mess)
+{
+    fputs(mess, stderr);
+    fflush(stderr);
+}
+
+/*
+ * NAME:	P->mmap()
+ * DESCRIPTION:	map a region of memory, with transparent (1) or explicit (2)
+ *		huge pages where the system supports them
+ */
+void *P_mmap(size_t size, int huge)
+{
+    char *mem;
+    size_t offset;
+
+# ifdef MAP_HUGETLB
+    if (huge == 2) {
+	mem = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mem != (char *) MAP_FAILED) {
+	    return mem;
+	}
+	/* no huge pages reserved by the system: fall back to transparent */
+    }
+# endif
+    if (huge == 0) {
+	mem = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return (mem != (char *) MAP_FAILED) ? mem : NULL;
+    }
+
+    /* align on a huge page boundary, and unmap the excess */
+    mem = (char *) mmap(NULL, size + HUGE_PAGE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == (char *) MAP_FAILED) {
+	return NULL;
+    }
+    offset = ALGN((uintptr_t) mem, HUGE_PAGE) - (uintptr_t) mem;
+    if (offset != 0) {
+	munmap(mem, offset);
+    }
+    munmap(mem + offset + size, HUGE_PAGE - offset);
+    mem += offset;
+# ifdef MADV_HUGEPAGE
+    madvise(mem, size, MADV_HUGEPAGE);
+# endif
+    return mem;
+}
+
+/*
+ * NAME:	P->munmap()
+ * DESCRIPTION:	unmap a region of memory
+ */
+void P_munmap(void *mem, size_t size)
+{
+    munmap(mem, size);
+}
+
+/*
+ * NAME:	P->mrelease()
+ * DESCRIPTION:	return the pages of an unused part of a mapped region to the
+ *		system, while keeping the region mapped
+ */
+void P_mrelease(void *mem, size_t size)
+{
+    madvise(mem, size, MADV_DONTNEED);
+}
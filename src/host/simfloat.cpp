@@ -21,6 +21,10 @@
 # include "dgd.h"
 # include "xfloat.h"
 
+# ifdef NATIVEFLOAT
+# error NATIVEFLOAT requires host floats
+# endif
+
 class Flt {
 public:
     void add(Flt *b);
@@ -33,3 +33,24 @@ voidf *P_dload(char *module, const char *symbol)
     }
     return (voidf *) dlsym(h, symbol);
 }
+
+/*
+ * NAME:	P->daddr()
+ * DESCRIPTION:	describe a code address as module+offset, in a buffer of
+ *		at least STRINGSZ bytes
+ */
+char *P_daddr(void *addr, char *buf)
+{
+    Dl_info info;
+    const char *name;
+
+    if (dladdr(addr, &info) == 0 || info.dli_fname == (char *) NULL) {
+	sprintf(buf, "%p", addr);
+    } else {
+	name = strrchr(info.dli_fname, '/');
+	name = (name != (char *) NULL) ? name + 1 : info.dli_fname;
+	sprintf(buf, "%.*s+0x%lx", STRINGSZ - 32, name,
+		(unsigned long) ((char *) addr - (char *) info.dli_fbase));
+    }
+    return buf;
+}
@@ -20,6 +20,10 @@
 # include "dgd.h"
 # include <time.h>
 # include <sys/time.h>
+# include <signal.h>
+# if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# include <x86intrin.h>
+# endif
 
 /*
  * NAME:	P->time()
@@ -72,3 +76,60 @@ char *P_ctime(char *buf, Uint time)
     }
     return buf;
 }
+
+static void (*proffunc)();	/* called on each profiling tick */
+
+extern "C" {
+
+/*
+ * NAME:	prof()
+ * DESCRIPTION:	catch SIGPROF
+ */
+static void prof(int arg)
+{
+    UNREFERENCED_PARAMETER(arg);
+    (*proffunc)();
+}
+
+}
+
+/*
+ * NAME:	P->profile()
+ * DESCRIPTION:	call func each time the given number of microseconds of CPU
+ *		time has been used, or stop if the interval is 0
+ */
+void P_profile(Uint interval, void (*func)())
+{
+    struct sigaction act;
+    struct itimerval timer;
+
+    if (interval != 0) {
+	proffunc = func;
+	memset(&act, '\0', sizeof(struct sigaction));
+	act.sa_handler = prof;
+	act.sa_flags = SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	sigaction(SIGPROF, &act, (struct sigaction *) NULL);
+    }
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, (struct itimerval *) NULL);
+}
+
+/*
+ * NAME:	P->cycles()
+ * DESCRIPTION:	return a fast, monotonic cycle counter
+ */
+Uuint P_cycles()
+{
+# if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    return __rdtsc();
+# else
+    struct timespec time;
+
+    /* no cycle counter: use nanoseconds instead */
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (Uuint) time.tv_sec * 1000000000 + time.tv_nsec;
+# endif
+}
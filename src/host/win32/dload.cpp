@@ -34,3 +34,28 @@ voidf *P_dload(char *module, const char *symbol)
     }
     return (voidf *) GetProcAddress(h, symbol);
 }
+
+/*
+ * NAME:	P->daddr()
+ * DESCRIPTION:	describe a code address as module+offset, in a buffer of
+ *		at least STRINGSZ bytes
+ */
+char *P_daddr(void *addr, char *buf)
+{
+    HMODULE h;
+    char path[MAX_PATH];
+    const char *name;
+
+    if (!GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+			   GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			   (LPCTSTR) addr, &h) ||
+	GetModuleFileName(h, path, MAX_PATH) == 0) {
+	sprintf(buf, "%p", addr);
+    } else {
+	name = strrchr(path, '\\');
+	name = (name != (char *) NULL) ? name + 1 : path;
+	sprintf(buf, "%.*s+0x%lx", STRINGSZ - 32, name,
+		(unsigned long) ((char *) addr - (char *) h));
+    }
+    return buf;
+}
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+# include <windows.h>
 # include "dgd.h"
 
 /*
@@ -36,3 +37,43 @@ long P_random()
 {
     return (long) (rand() ^ (rand() << 9) ^ (rand() << 16));
 }
+
+/*
+ * NAME:	P->mmap()
+ * DESCRIPTION:	map a region of memory, with large pages if explicit huge
+ *		pages (2) are requested and the process may use them
+ */
+void *P_mmap(size_t size, int huge)
+{
+    void *mem;
+
+    if (huge == 2) {
+	mem = VirtualAlloc(NULL, size,
+			   MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+			   PAGE_READWRITE);
+	if (mem != NULL) {
+	    return mem;
+	}
+    }
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+/*
+ * NAME:	P->munmap()
+ * DESCRIPTION:	unmap a region of memory
+ */
+void P_munmap(void *mem, size_t size)
+{
+    UNREFERENCED_PARAMETER(size);
+    VirtualFree(mem, 0, MEM_RELEASE);
+}
+
+/*
+ * NAME:	P->mrelease()
+ * DESCRIPTION:	return the pages of an unused part of a mapped region to the
+ *		system, while keeping the region mapped
+ */
+void P_mrelease(void *mem, size_t size)
+{
+    VirtualAlloc(mem, size, MEM_RESET, PAGE_READWRITE);
+}
@@ -19,6 +19,7 @@
 
 # include <windows.h>
 # include <time.h>
+# include <intrin.h>
 # include "dgd.h"
 
 # define UNIXBIRTH	0x019db1ded53e8000
@@ -88,3 +89,47 @@ char *P_ctime(char *buf, Uint time)
     }
     return buf;
 }
+
+static HANDLE proftimer;	/* profiling timer */
+static void (*proffunc)();	/* called on each profiling tick */
+
+/*
+ * NAME:	prof()
+ * DESCRIPTION:	profiling timer callback
+ */
+static VOID CALLBACK prof(PVOID arg, BOOLEAN fired)
+{
+    UNREFERENCED_PARAMETER(arg);
+    UNREFERENCED_PARAMETER(fired);
+    (*proffunc)();
+}
+
+/*
+ * NAME:	P->profile()
+ * DESCRIPTION:	call func each time the given number of microseconds has
+ *		passed, or stop if the interval is 0
+ */
+void P_profile(Uint interval, void (*func)())
+{
+    DWORD msec;
+
+    if (proftimer != NULL) {
+	DeleteTimerQueueTimer(NULL, proftimer, NULL);
+	proftimer = NULL;
+    }
+    if (interval != 0) {
+	proffunc = func;
+	msec = (interval + 999) / 1000;
+	CreateTimerQueueTimer(&proftimer, NULL, prof, NULL, msec, msec,
+			      WT_EXECUTEDEFAULT);
+    }
+}
+
+/*
+ * NAME:	P->cycles()
+ * DESCRIPTION:	return a fast, monotonic cycle counter
+ */
+Uuint P_cycles()
+{
+    return __rdtsc();
+}
@@ -18,6 +18,7 @@
  */
 
 # include "dgd.h"
+# include "hash.h"
 # include "str.h"
 # include "array.h"
 # include "object.h"
@@ -25,6 +26,7 @@
 # include "control.h"
 # include "data.h"
 # include "interpret.h"
+# include "profile.h"
 # include "table.h"
 
 # ifdef DEBUG
@@ -32,6 +34,10 @@
 # define EXTRA_STACK  0
 # endif
 
+# if defined(__GNUC__) && !defined(NOTHREADED)
+# define THREADED	/* computed goto dispatch */
+# endif
+
 
 static Value stack[MIN_STACK];	/* initial stack */
 static Frame topframe;		/* top frame */
@@ -85,7 +91,7 @@ void Frame::growStack(int size)
 	/* move stack values */
 	v = stk + size;
 	if (spsize != 0) {
-	    memcpy(v - spsize, sp, spsize * sizeof(Value));
+	    memcpy((void *) (v - spsize), sp, spsize * sizeof(Value));
 	}
 	sp = v - spsize;
 
@@ -310,7 +316,7 @@ int Frame::spread(int n)
 	return n - 1;
     } else {
 	/* including lvalues */
-	if (n > a->size) {
+	if (n > (int) a->size) {
 	    n = a->size;
 	}
 	i_add_ticks(this, n);
@@ -371,7 +377,8 @@ void Frame::index(Value *aval, Value *ival, Value *val, bool keep)
 	if (ival->type != T_INT) {
 	    error("Non-numeric string index");
 	}
-	i = UCHAR(aval->string->text[aval->string->index(ival->number)]);
+	i = aval->string->index(ival->number);
+	i = UCHAR(aval->string->text.chars()[i]);
 	if (!keep) {
 	    aval->string->del();
 	}
@@ -947,12 +954,13 @@ void Frame::stores(int skip, int assign)
  */
 unsigned short Frame::storesSpread(int n, int offset, int type, Uint sclass)
 {
-    unsigned short nassign, nspread;
+    unsigned short nassign;
+    asizet nspread;
 
     nassign = sp->array->size;
-    if (n < nassign && sp[1].array->size > offset) {
+    if (n < nassign && (int) sp[1].array->size > offset) {
 	nspread = sp[1].array->size - offset;
-	if (nspread >= nassign - n) {
+	if ((int) nspread >= nassign - n) {
 	    nspread = nassign - n;
 	    i_add_ticks(this, nspread * 3);
 	    while (nspread != 0) {
@@ -1425,172 +1433,61 @@ void Frame::typecheck(Frame *f, const char *name, const char *ftype,
 /*
  * handle an int switch
  */
-unsigned short Frame::switchInt(char *pc)
+Uint Frame::switchInt(Uint *pc)
 {
-    unsigned short h, l, m, sz, dflt;
+    Uint h, l, m, dflt;
     Int num;
-    char *p;
+    Uint *p;
 
-    FETCH2U(pc, h);
-    sz = FETCH1U(pc);
-    FETCH2U(pc, dflt);
+    h = *pc++;
+    dflt = *pc++;
     if (sp->type != T_INT) {
 	return dflt;
     }
 
+    num = sp->number;
     l = 0;
-    --h;
-    switch (sz) {
-    case 1:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 3 * m;
-	    num = FETCH1S(p);
-	    if (sp->number == num) {
-		return FETCH2U(p, l);
-	    } else if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		l = m + 1;	/* search in upper half */
-	    }
-	}
-	break;
-
-    case 2:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 4 * m;
-	    FETCH2S(p, num);
-	    if (sp->number == num) {
-		return FETCH2U(p, l);
-	    } else if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		l = m + 1;	/* search in upper half */
-	    }
-	}
-	break;
-
-    case 3:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 5 * m;
-	    FETCH3S(p, num);
-	    if (sp->number == num) {
-		return FETCH2U(p, l);
-	    } else if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		l = m + 1;	/* search in upper half */
-	    }
-	}
-	break;
-
-    case 4:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 6 * m;
-	    FETCH4S(p, num);
-	    if (sp->number == num) {
-		return FETCH2U(p, l);
-	    } else if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		l = m + 1;	/* search in upper half */
-	    }
+    while (l < h) {
+	m = (l + h) >> 1;
+	p = pc + 2 * m;
+	if (num == (Int) p[0]) {
+	    return p[1];
+	} else if (num < (Int) p[0]) {
+	    h = m;	/* search in lower half */
+	} else {
+	    l = m + 1;	/* search in upper half */
 	}
-	break;
     }
-
     return dflt;
 }
 
 /*
  * handle a range switch
  */
-unsigned short Frame::switchRange(char *pc)
+Uint Frame::switchRange(Uint *pc)
 {
-    unsigned short h, l, m, sz, dflt;
+    Uint h, l, m, dflt;
     Int num;
-    char *p;
+    Uint *p;
 
-    FETCH2U(pc, h);
-    sz = FETCH1U(pc);
-    FETCH2U(pc, dflt);
+    h = *pc++;
+    dflt = *pc++;
     if (sp->type != T_INT) {
 	return dflt;
     }
 
+    num = sp->number;
     l = 0;
-    --h;
-    switch (sz) {
-    case 1:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 4 * m;
-	    num = FETCH1S(p);
-	    if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		num = FETCH1S(p);
-		if (sp->number <= num) {
-		    return FETCH2U(p, l);
-		}
-		l = m + 1;	/* search in upper half */
-	    }
-	}
-	break;
-
-    case 2:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 6 * m;
-	    FETCH2S(p, num);
-	    if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		FETCH2S(p, num);
-		if (sp->number <= num) {
-		    return FETCH2U(p, l);
-		}
-		l = m + 1;	/* search in upper half */
-	    }
-	}
-	break;
-
-    case 3:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 8 * m;
-	    FETCH3S(p, num);
-	    if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		FETCH3S(p, num);
-		if (sp->number <= num) {
-		    return FETCH2U(p, l);
-		}
-		l = m + 1;	/* search in upper half */
-	    }
-	}
-	break;
-
-    case 4:
-	while (l < h) {
-	    m = (l + h) >> 1;
-	    p = pc + 10 * m;
-	    FETCH4S(p, num);
-	    if (sp->number < num) {
-		h = m;	/* search in lower half */
-	    } else {
-		FETCH4S(p, num);
-		if (sp->number <= num) {
-		    return FETCH2U(p, l);
-		}
-		l = m + 1;	/* search in upper half */
-	    }
+    while (l < h) {
+	m = (l + h) >> 1;
+	p = pc + 3 * m;
+	if (num < (Int) p[0]) {
+	    h = m;	/* search in lower half */
+	} else if (num <= (Int) p[1]) {
+	    return p[2];
+	} else {
+	    l = m + 1;	/* search in upper half */
 	}
-	break;
     }
     return dflt;
 }
@@ -1598,38 +1495,33 @@ unsigned short Frame::switchRange(char *pc)
 /*
  * handle a string switch
  */
-unsigned short Frame::switchStr(char *pc)
+Uint Frame::switchStr(Uint *pc)
 {
-    unsigned short h, l, m, u, u2, dflt;
-    int cmp;
-    char *p;
+    Uint n, dflt, mask, hash, i, slot;
+    String *str;
+    Uint *p, *table;
 
-    FETCH2U(pc, h);
-    FETCH2U(pc, dflt);
-    if (FETCH1U(pc) == 0) {
-	FETCH2U(pc, l);
-	if (VAL_NIL(sp)) {
-	    return l;
-	}
-	--h;
+    n = *pc++;
+    dflt = *pc++;
+    if (VAL_NIL(sp)) {
+	return *pc;
     }
+    pc++;
     if (sp->type != T_STRING) {
 	return dflt;
     }
 
-    l = 0;
-    --h;
-    while (l < h) {
-	m = (l + h) >> 1;
-	p = pc + 5 * m;
-	u = FETCH1U(p);
-	cmp = sp->string->cmp(p_ctrl->strconst(u, FETCH2U(p, u2)));
-	if (cmp == 0) {
-	    return FETCH2U(p, l);
-	} else if (cmp < 0) {
-	    h = m;	/* search in lower half */
-	} else {
-	    l = m + 1;	/* search in upper half */
+    /* look up the string in the hash table following the cases */
+    str = sp->string;
+    table = pc + 3 * n;
+    mask = *table++;
+    hash = str->hash() & 0xffff;
+    for (i = hash & mask; (slot = table[i]) != 0; i = (i + 1) & mask) {
+	if ((slot >> 16) == hash) {
+	    p = pc + 3 * ((slot & 0xffff) - 1);
+	    if (str->cmp(p_ctrl->strconst(p[0], p[1])) == 0) {
+		return p[2];
+	    }
 	}
     }
     return dflt;
@@ -1641,6 +1533,9 @@ unsigned short Frame::switchStr(char *pc)
 void Frame::kfunc(int n, int nargs)
 {
     struct kfunc *kf;
+# ifdef INSTRCOUNT
+    Uuint cycles;
+# endif
 
     kf = &KFUN(n);
     if (PROTO_VARGS(kf->proto) == 0 && nargs != PROTO_NARGS(kf->proto)) {
@@ -1653,7 +1548,13 @@ void Frame::kfunc(int n, int nargs)
     if (PROTO_CLASS(kf->proto) & C_TYPECHECKED) {
 	typecheck((Frame *) NULL, kf->name, "kfun", kf->proto, nargs, TRUE);
     }
+# ifdef INSTRCOUNT
+    cycles = P_cycles();
     nargs = (*kf->func)(this, nargs, kf);
+    Profile::kfun(kf - kftab, P_cycles() - cycles);
+# else
+    nargs = (*kf->func)(this, nargs, kf);
+# endif
     if (nargs != 0) {
 	if (nargs < 0) {
 	    error("Too few arguments for kfun %s", kf->name);
@@ -1677,191 +1578,1125 @@ void Frame::vfunc(int n, int nargs)
 }
 
 /*
- * Main interpreter function. Interpret stack machine code.
+ * skip the store instructions which follow I_STORES
  */
-void Frame::interpret(char *pc)
+static char *skipStores(char *pc, int n)
 {
-    unsigned short instr, u, u2;
-    Uint l;
-    char *p;
-    struct kfunc *kf;
-    int size, instance;
-    bool atomic;
-    Value val;
-
-    size = 0;
-    l = 0;
-
-    for (;;) {
-# ifdef DEBUG
-	if (sp < stack + MIN_STACK) {
-	    fatal("out of value stack");
+    if (n != 0 && (UCHAR(*pc) & I_INSTR_MASK) == I_SPREAD) {
+	/* lvalue spread */
+	pc++;
+	if (FETCH1S(pc) >= 0 && FETCH1U(pc) == T_CLASS) {
+	    pc += 3;
 	}
-# endif
-	instr = FETCH1U(pc);
-	this->pc = pc;
+	--n;
+    }
 
-	switch (instr & I_INSTR_MASK) {
-	case I_PUSH_INT1:
-	    PUSH_INTVAL(this, FETCH1S(pc));
+    while (n != 0) {
+	switch (FETCH1U(pc) & I_INSTR_MASK) {
+	case I_CAST:
+	case I_CAST | I_POP_BIT:
+	    if (FETCH1U(pc) == T_CLASS) {
+		pc += 3;
+	    }
 	    continue;
 
-	case I_PUSH_INT2:
-	    PUSH_INTVAL(this, FETCH2S(pc, u));
-	    continue;
+	case I_STORE_LOCAL:
+	case I_STORE_LOCAL | I_POP_BIT:
+	case I_STORE_GLOBAL:
+	case I_STORE_GLOBAL | I_POP_BIT:
+	case I_STORE_LOCAL_INDEX:
+	case I_STORE_LOCAL_INDEX | I_POP_BIT:
+	case I_STORE_GLOBAL_INDEX:
+	case I_STORE_GLOBAL_INDEX | I_POP_BIT:
+	    pc++;
+	    break;
 
-	case I_PUSH_INT4:
-	    PUSH_INTVAL(this, FETCH4S(pc, l));
-	    continue;
+	case I_STORE_FAR_GLOBAL:
+	case I_STORE_FAR_GLOBAL | I_POP_BIT:
+	case I_STORE_FAR_GLOBAL_INDEX:
+	case I_STORE_FAR_GLOBAL_INDEX | I_POP_BIT:
+	    pc += 2;
+	    break;
+	}
+	--n;
+    }
 
-	case I_PUSH_FLOAT6:
-	    FETCH2U(pc, u);
-	    PUSH_FLTCONST(this, u, FETCH4U(pc, l));
-	    continue;
+    return pc;
+}
 
-	case I_PUSH_STRING:
-	    PUSH_STRVAL(this, p_ctrl->strconst(p_ctrl->ninherits - 1,
-					       FETCH1U(pc)));
-	    continue;
+/*
+ * fetch an int constant pushed by the instruction at pc, return the next
+ * instruction or NULL
+ */
+static char *pushInt(char *pc, Int *num)
+{
+    unsigned short u;
+    Uint l;
 
-	case I_PUSH_NEAR_STRING:
-	    u = FETCH1U(pc);
-	    PUSH_STRVAL(this, p_ctrl->strconst(u, FETCH1U(pc)));
-	    continue;
+    switch (FETCH1U(pc) & ~I_LINE_MASK) {
+    case I_PUSH_INT1:
+	*num = FETCH1S(pc);
+	return pc;
 
-	case I_PUSH_FAR_STRING:
-	    u = FETCH1U(pc);
-	    PUSH_STRVAL(this, p_ctrl->strconst(u, FETCH2U(pc, u2)));
-	    continue;
+    case I_PUSH_INT2:
+	*num = FETCH2S(pc, u);
+	return pc;
 
-	case I_PUSH_LOCAL:
-	    u = FETCH1S(pc);
-	    pushValue(((short) u < 0) ? fp + (short) u : argp + u);
-	    continue;
+    case I_PUSH_INT4:
+	*num = FETCH4S(pc, l);
+	return pc;
 
-	case I_PUSH_GLOBAL:
-	    pushValue(global(p_ctrl->ninherits - 1, FETCH1U(pc)));
-	    continue;
+    default:
+	return (char *) NULL;
+    }
+}
 
-	case I_PUSH_FAR_GLOBAL:
-	    u = FETCH1U(pc);
-	    pushValue(global(u, FETCH1U(pc)));
-	    continue;
+/*
+ * return the builtin int kfun called by the instruction at pc, or -1
+ */
+static int intKfun(char *pc)
+{
+    if ((UCHAR(pc[0]) & ~I_LINE_MASK & ~I_POP_BIT) != I_CALL_KFUNC) {
+	return -1;
+    }
+    switch (UCHAR(pc[1])) {
+    case KF_ADD_INT:
+    case KF_ADD1_INT:
+    case KF_AND_INT:
+    case KF_DIV_INT:
+    case KF_EQ_INT:
+    case KF_GE_INT:
+    case KF_GT_INT:
+    case KF_LE_INT:
+    case KF_LSHIFT_INT:
+    case KF_LT_INT:
+    case KF_MOD_INT:
+    case KF_MULT_INT:
+    case KF_NE_INT:
+    case KF_OR_INT:
+    case KF_RSHIFT_INT:
+    case KF_SUB_INT:
+    case KF_SUB1_INT:
+    case KF_XOR_INT:
+	return UCHAR(pc[1]);
 
-	case I_INDEX:
-	case I_INDEX | I_POP_BIT:
-	    index(sp + 1, sp, &val, FALSE);
-	    *++sp = val;
-	    break;
+    default:
+	return -1;
+    }
+}
 
-	case I_INDEX2:
-	    index(sp + 1, sp, &val, TRUE);
-	    *--sp = val;
-	    continue;
+/*
+ * return the comparison performed by an int kfun, inverted if needed, or -1
+ */
+static int compare(int kf, bool invert)
+{
+    switch (kf) {
+    case KF_EQ_INT:
+	return (invert) ? KF_NE_INT : KF_EQ_INT;
 
-	case I_AGGREGATE:
-	case I_AGGREGATE | I_POP_BIT:
-	    if (FETCH1U(pc) == 0) {
-		aggregate(FETCH2U(pc, u));
-	    } else {
-		mapAggregate(FETCH2U(pc, u));
-	    }
-	    break;
+    case KF_NE_INT:
+	return (invert) ? KF_EQ_INT : KF_NE_INT;
 
-	case I_SPREAD:
-	    u = FETCH1S(pc);
-	    size = spread(-(short) u - 2);
-	    continue;
+    case KF_LT_INT:
+	return (invert) ? KF_GE_INT : KF_LT_INT;
 
-	case I_CAST:
-	case I_CAST | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    if (u == T_CLASS) {
-		FETCH3U(pc, l);
-	    }
-	    cast(sp, u, l);
-	    break;
+    case KF_GE_INT:
+	return (invert) ? KF_LT_INT : KF_GE_INT;
 
-	case I_INSTANCEOF:
-	case I_INSTANCEOF | I_POP_BIT:
-	    instance = instanceOf(FETCH3U(pc, l));
-	    PUT_INTVAL(sp, instance);
-	    break;
+    case KF_GT_INT:
+	return (invert) ? KF_LE_INT : KF_GT_INT;
 
-	case I_STORES:
-	case I_STORES | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    this->pc = pc;
-	    if (kflv) {
-		kflv = FALSE;
-		lvalues(u);
-	    } else {
-		if (sp->type != T_ARRAY) {
-		    error("Value is not an array");
-		}
-		if (u > sp->array->size) {
-		    error("Wrong number of lvalues");
-		}
-		Dataspace::elts(sp->array);
-		stores(0, u);
-	    }
-	    pc = this->pc;
-	    break;
+    case KF_LE_INT:
+	return (invert) ? KF_GT_INT : KF_LE_INT;
 
-	case I_STORE_LOCAL:
-	case I_STORE_LOCAL | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    if (SCHAR(u) >= 0) {
-		storeParam(u, sp);
-	    } else {
-		storeLocal(-SCHAR(u), sp);
-	    }
-	    break;
+    default:
+	return -1;
+    }
+}
 
-	case I_STORE_GLOBAL:
-	case I_STORE_GLOBAL | I_POP_BIT:
-	    storeGlobal(p_ctrl->ninherits - 1, FETCH1U(pc), sp);
-	    break;
+/*
+ * translate a builtin int kfun, or a float kfun on host doubles, into an
+ * instruction which the interpreter performs inline, or return 0
+ */
+static unsigned short inlineKfun(int kf, Uint **code)
+{
+    Uint *c;
 
-	case I_STORE_FAR_GLOBAL:
-	case I_STORE_FAR_GLOBAL | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    storeGlobal(u, FETCH1U(pc), sp);
-	    break;
+    c = *code;
+    switch (kf) {
+    case KF_ADD1_INT:
+	c[0] = KF_ADD_INT;
+	c[1] = 1;
+	break;
 
-	case I_STORE_INDEX:
-	case I_STORE_INDEX | I_POP_BIT:
-	    storeIndex(sp);
-	    break;
+    case KF_SUB1_INT:
+	c[0] = KF_SUB_INT;
+	c[1] = 1;
+	break;
 
-	case I_STORE_LOCAL_INDEX:
-	case I_STORE_LOCAL_INDEX | I_POP_BIT:
-	    u = FETCH1S(pc);
-	    if (SCHAR(u) >= 0) {
-		storeParamIndex(u, sp);
-	    } else {
-		storeLocalIndex(-SCHAR(u), sp);
-	    }
-	    break;
+    case KF_NEG_INT:
+	c[0] = KF_XOR_INT;
+	c[1] = (Uint) -1;
+	break;
 
-	case I_STORE_GLOBAL_INDEX:
-	case I_STORE_GLOBAL_INDEX | I_POP_BIT:
-	    storeGlobalIndex(p_ctrl->ninherits - 1, FETCH1U(pc), sp);
-	    break;
+    case KF_NOT_INT:
+	c[0] = KF_EQ_INT;
+	c[1] = 0;
+	break;
 
-	case I_STORE_FAR_GLOBAL_INDEX:
-	case I_STORE_FAR_GLOBAL_INDEX | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    storeGlobalIndex(u, FETCH1U(pc), sp);
-	    break;
+    case KF_TST_INT:
+	c[0] = KF_NE_INT;
+	c[1] = 0;
+	break;
 
-	case I_STORE_INDEX_INDEX:
-	case I_STORE_INDEX_INDEX | I_POP_BIT:
-	    storeIndexIndex(sp);
+    case KF_UMIN_INT:
+	c[0] = KF_UMIN_INT;
+	c[1] = 0;
+	break;
+
+    case KF_ADD_INT:
+    case KF_AND_INT:
+    case KF_DIV_INT:
+    case KF_EQ_INT:
+    case KF_GE_INT:
+    case KF_GT_INT:
+    case KF_LE_INT:
+    case KF_LSHIFT_INT:
+    case KF_LT_INT:
+    case KF_MOD_INT:
+    case KF_MULT_INT:
+    case KF_NE_INT:
+    case KF_OR_INT:
+    case KF_RSHIFT_INT:
+    case KF_SUB_INT:
+    case KF_XOR_INT:
+	*c++ = kf;
+	*code = c;
+	return I_KFUNC_INT;
+
+# ifdef NATIVEFLOAT
+    case KF_ADD_FLT:
+    case KF_ADD1_FLT:
+    case KF_DIV_FLT:
+    case KF_EQ_FLT:
+    case KF_GE_FLT:
+    case KF_GT_FLT:
+    case KF_LE_FLT:
+    case KF_LT_FLT:
+    case KF_MULT_FLT:
+    case KF_NE_FLT:
+    case KF_NOT_FLT:
+    case KF_SUB_FLT:
+    case KF_SUB1_FLT:
+    case KF_TST_FLT:
+    case KF_UMIN_FLT:
+	*c++ = kf;
+	*code = c;
+	return I_KFUNC_FLT;
+# endif
+
+    default:
+	return 0;
+    }
+
+    /* unary int kfun as an operation with a constant */
+    *code = c + 2;
+    return I_INT_CONST;
+}
+
+/*
+ * Attempt to replace the sequence of instructions at pc by a single
+ * superinstruction.  None of the instructions following the first may be
+ * a jump target.  Return the end of the sequence, or NULL.
+ */
+static char *fuse(Control *ctrl, char *pc, char *end, char *labels,
+		  Uint **code, unsigned short *instr)
+{
+    char *p, *q;
+    Uint *c;
+    int local, kf;
+    Int num;
+    unsigned short op;
+
+    c = *code;
+    p = pc;
+    switch (FETCH1U(p) & ~I_LINE_MASK) {
+    case I_PUSH_INT1:
+    case I_PUSH_INT2:
+    case I_PUSH_INT4:
+	/* int kfun with constant */
+	p = pushInt(pc, &num);
+	if (p >= end || labels[p - pc] || (kf = intKfun(p)) < 0 ||
+	    kf == KF_ADD1_INT || kf == KF_SUB1_INT) {
+	    return (char *) NULL;
+	}
+	*instr = I_INT_CONST | (UCHAR(*p) & I_POP_BIT);
+	*c++ = kf;
+	*c++ = num;
+	*code = c;
+	return p + 2;
+
+    case I_PUSH_GLOBAL:
+    case I_PUSH_FAR_GLOBAL:
+	/* global indexed by local */
+	if ((UCHAR(*pc) & ~I_LINE_MASK) == I_PUSH_GLOBAL) {
+	    c[0] = ctrl->ninherits - 1;
+	    c[1] = FETCH1U(p);
+	} else {
+	    c[0] = FETCH1U(p);
+	    c[1] = FETCH1U(p);
+	}
+	if (p >= end || labels[p - pc] ||
+	    (UCHAR(*p) & ~I_LINE_MASK) != I_PUSH_LOCAL) {
+	    return (char *) NULL;
+	}
+	c[2] = SCHAR(p[1]);
+	p += 2;
+	if (p >= end || labels[p - pc] ||
+	    (UCHAR(*p) & ~I_LINE_MASK & ~I_POP_BIT) != I_INDEX) {
+	    return (char *) NULL;
+	}
+	*instr = I_INDEX_GLOBAL | (UCHAR(*p) & I_POP_BIT);
+	*code = c + 3;
+	return p + 1;
+
+    case I_PUSH_LOCAL:
+	local = FETCH1S(p);
+	if (p >= end || labels[p - pc]) {
+	    return (char *) NULL;
+	}
+	op = UCHAR(*p) & ~I_LINE_MASK;
+	if (op == I_PUSH_LOCAL) {
+	    /* compare locals and jump */
+	    *instr = I_JUMP_LOCAL;
+	    num = SCHAR(p[1]);
+	    p += 2;
+	} else if ((q = pushInt(p, &num)) != (char *) NULL) {
+	    /* local with constant */
+	    *instr = I_JUMP_LOCAL_INT;
+	    p = q;
+	} else {
+	    /* local increment */
+	    *instr = I_ADD_LOCAL;
+	    num = 0;
+	}
+	if (p >= end || labels[p - pc] || (kf = intKfun(p)) < 0 ||
+	    (UCHAR(*p) & I_POP_BIT)) {
+	    return (char *) NULL;
+	}
+	p += 2;
+	if (p >= end || labels[p - pc]) {
+	    return (char *) NULL;
+	}
+	op = UCHAR(*p) & ~I_LINE_MASK;
+
+	if (*instr == I_ADD_LOCAL) {
+	    if (kf == KF_ADD1_INT) {
+		num = 1;
+	    } else if (kf == KF_SUB1_INT) {
+		num = -1;
+	    } else {
+		return (char *) NULL;
+	    }
+	} else if (*instr == I_JUMP_LOCAL_INT) {
+	    if (kf == KF_ADD_INT) {
+		*instr = I_ADD_LOCAL;
+	    } else if (kf == KF_SUB_INT) {
+		*instr = I_ADD_LOCAL;
+		num = -num;
+	    }
+	}
+	if (*instr == I_ADD_LOCAL) {
+	    /* local += constant */
+	    if ((op & ~I_POP_BIT) != I_STORE_LOCAL || SCHAR(p[1]) != local) {
+		return (char *) NULL;
+	    }
+	    *instr = I_ADD_LOCAL | (op & I_POP_BIT);
+	    *c++ = local;
+	    *c++ = num;
+	    *code = c;
+	    return p + 2;
+	}
+
+	/* compare and jump */
+	if (op != I_JUMP_ZERO && op != I_JUMP_NONZERO) {
+	    return (char *) NULL;
+	}
+	kf = compare(kf, (op == I_JUMP_ZERO));
+	if (kf < 0) {
+	    return (char *) NULL;
+	}
+	*c++ = local;
+	*c++ = num;
+	*c++ = kf;
+	*c++ = (UCHAR(p[1]) << 8) | UCHAR(p[2]);
+	*code = c;
+	return p + 3;
+
+    default:
+	return (char *) NULL;
+    }
+}
+
+/*
+ * return a switch case value of sz bytes
+ */
+static Int caseValue(char *pc, int sz)
+{
+    unsigned short u;
+    Uint l;
+
+    switch (sz) {
+    case 1:
+	return FETCH1S(pc);
+
+    case 2:
+	return FETCH2S(pc, u);
+
+    case 3:
+	return FETCH3S(pc, l);
+
+    default:
+	return FETCH4S(pc, l);
+    }
+}
+
+/*
+ * append a hash table for the cases of a string switch, with slots holding
+ * the hash of a case string and its index + 1
+ */
+static Uint *hashCases(Control *ctrl, Uint *cases, Uint n, Uint *c)
+{
+    Uint size, i, j, hash;
+    String *str;
+
+    for (size = 1; size < 2 * n; size <<= 1) ;
+    *c++ = size - 1;
+    memset(c, '\0', size * sizeof(Uint));
+    for (i = 0; i < n; i++, cases += 3) {
+	str = ctrl->strconst(cases[0], cases[1]);
+	hash = str->hash() & 0xffff;
+	for (j = hash & (size - 1); c[j] != 0; j = (j + 1) & (size - 1)) ;
+	c[j] = (hash << 16) | (i + 1);
+    }
+    return c + size;
+}
+
+# define FUSED		((Uint) -1)	/* within a superinstruction */
+
+/*
+ * Translate the code of a function into an array of native-endian words.
+ * Each instruction starts with a word holding the instruction without its
+ * line bits, and the offset of the next instruction in the original code
+ * shifted left by 8.  It is followed by the operands, one word each, with
+ * jump targets pointing into the translated code.  Common sequences of
+ * instructions are replaced by superinstructions.
+ */
+Uint *Frame::decode(Control *ctrl, char *pc)
+{
+    char *prog, *end, *labels, *p;
+    Uint *code, *c, *map, *fix, *f, *calls, *cc, *start, *count;
+    unsigned short instr, len, n, u, sz, dflt;
+    Uint l, slot;
+    Int num, low, high;
+    bool retry;
+
+    pc += PROTO_SIZE(pc) + 3;
+    FETCH2U(pc, len);
+    prog = pc;
+    end = pc + len;
+
+    /* translated code takes at most 2 words for each byte */
+    code = ALLOC(Uint, 2 * len);
+    map = ALLOC(Uint, len + 1);
+    fix = ALLOC(Uint, len);
+    calls = ALLOC(Uint, len);
+    labels = ALLOC(char, len);
+    memset(labels, '\0', len);
+
+    do {
+	/* translate the code, fusing instructions which are not labels */
+	pc = prog;
+	c = code;
+	f = fix;
+	cc = calls;
+	while (pc < end) {
+	    map[pc - prog] = c - code;
+	    start = c++;
+	    p = fuse(ctrl, pc, end, labels + (pc - prog), &c, &instr);
+	    if (p != (char *) NULL) {
+		/* superinstruction */
+		if (instr == I_JUMP_LOCAL || instr == I_JUMP_LOCAL_INT) {
+		    *f++ = c - 1 - code;
+		}
+		while (++pc < p) {
+		    map[pc - prog] = FUSED;
+		}
+	    } else {
+		instr = FETCH1U(pc) & ~I_LINE_MASK;
+		switch (instr) {
+		case I_PUSH_INT1:
+		    *c++ = FETCH1S(pc);
+		    break;
+
+		case I_PUSH_INT2:
+		    *c++ = FETCH2S(pc, u);
+		    break;
+
+		case I_PUSH_INT4:
+		    *c++ = FETCH4S(pc, l);
+		    break;
+
+		case I_PUSH_FLOAT6:
+		    *c++ = FETCH2U(pc, u);
+		    *c++ = FETCH4U(pc, l);
+		    break;
+
+		case I_PUSH_STRING:
+		case I_PUSH_GLOBAL:
+		case I_STORE_GLOBAL:
+		case I_STORE_GLOBAL | I_POP_BIT:
+		case I_STORE_GLOBAL_INDEX:
+		case I_STORE_GLOBAL_INDEX | I_POP_BIT:
+		    *c++ = ctrl->ninherits - 1;
+		    *c++ = FETCH1U(pc);
+		    break;
+
+		case I_PUSH_NEAR_STRING:
+		case I_PUSH_FAR_GLOBAL:
+		case I_STORE_FAR_GLOBAL:
+		case I_STORE_FAR_GLOBAL | I_POP_BIT:
+		case I_STORE_FAR_GLOBAL_INDEX:
+		case I_STORE_FAR_GLOBAL_INDEX | I_POP_BIT:
+		case I_CALL_CKFUNC:
+		case I_CALL_CKFUNC | I_POP_BIT:
+		case I_CALL_AFUNC:
+		case I_CALL_AFUNC | I_POP_BIT:
+		    *c++ = FETCH1U(pc);
+		    *c++ = FETCH1U(pc);
+		    break;
+
+		case I_PUSH_FAR_STRING:
+		    *c++ = FETCH1U(pc);
+		    *c++ = FETCH2U(pc, u);
+		    break;
+
+		case I_PUSH_LOCAL:
+		case I_STORE_LOCAL:
+		case I_STORE_LOCAL | I_POP_BIT:
+		case I_STORE_LOCAL_INDEX:
+		case I_STORE_LOCAL_INDEX | I_POP_BIT:
+		    *c++ = FETCH1S(pc);
+		    break;
+
+		case I_INDEX:
+		case I_INDEX | I_POP_BIT:
+		case I_INDEX2:
+		case I_STORE_INDEX:
+		case I_STORE_INDEX | I_POP_BIT:
+		case I_STORE_INDEX_INDEX:
+		case I_STORE_INDEX_INDEX | I_POP_BIT:
+		case I_RETURN:
+		    break;
+
+		case I_AGGREGATE:
+		case I_AGGREGATE | I_POP_BIT:
+		    *c++ = FETCH1U(pc);
+		    *c++ = FETCH2U(pc, u);
+		    break;
+
+		case I_SPREAD:
+		    *c++ = num = FETCH1S(pc);
+		    if (num >= 0 && FETCH1U(pc) == T_CLASS) {
+			/* lvalue spread, only executed by stores */
+			pc += 3;
+		    }
+		    break;
+
+		case I_CAST:
+		case I_CAST | I_POP_BIT:
+		    *c++ = u = FETCH1U(pc);
+		    l = 0;
+		    if (u == T_CLASS) {
+			FETCH3U(pc, l);
+		    }
+		    *c++ = l;
+		    break;
+
+		case I_INSTANCEOF:
+		case I_INSTANCEOF | I_POP_BIT:
+		    *c++ = FETCH3U(pc, l);
+		    break;
+
+		case I_STORES:
+		case I_STORES | I_POP_BIT:
+		    *c++ = u = FETCH1U(pc);
+		    *f++ = c - code;
+		    *c++ = skipStores(pc, u) - prog;
+		    break;
+
+		case I_JUMP_ZERO:
+		case I_JUMP_NONZERO:
+		case I_JUMP:
+		case I_CATCH:
+		case I_CATCH | I_POP_BIT:
+		    *f++ = c - code;
+		    *c++ = FETCH2U(pc, u);
+		    break;
+
+		case I_SWITCH:
+		    *c++ = u = FETCH1U(pc);
+		    FETCH2U(pc, n);
+		    switch (u) {
+		    case SWITCH_INT:
+			sz = FETCH1U(pc);
+			--n;
+			if (n != 0) {
+			    low = caseValue(pc + 2, sz);
+			    high = caseValue(pc + 2 + (n - 1) * (sz + 2), sz);
+			}
+			if (n != 0 && (Uint) high - (Uint) low < 2 * n) {
+			    /* dense: jump table */
+			    c[-1] = SWITCH_DENSE;
+			    *c++ = low;
+			    *c++ = (Uint) high - (Uint) low + 1;
+			    *f++ = c - code;
+			    *c++ = dflt = FETCH2U(pc, u);
+			    for (slot = 0; n != 0; --n) {
+				num = caseValue(pc, sz);
+				pc += sz;
+				while (slot < (Uint) num - (Uint) low) {
+				    *f++ = c - code;
+				    *c++ = dflt;
+				    slot++;
+				}
+				*f++ = c - code;
+				*c++ = FETCH2U(pc, u);
+				slot++;
+			    }
+			    break;
+			}
+			*c++ = n;
+			*f++ = c - code;
+			*c++ = FETCH2U(pc, u);
+			while (n != 0) {
+			    *c++ = caseValue(pc, sz);
+			    pc += sz;
+			    *f++ = c - code;
+			    *c++ = FETCH2U(pc, u);
+			    --n;
+			}
+			break;
+
+		    case SWITCH_RANGE:
+			sz = FETCH1U(pc);
+			--n;
+			if (n != 0) {
+			    low = caseValue(pc + 2, sz);
+			    high = caseValue(pc + 2 + (n - 1) * (2 * sz + 2) + sz,
+					     sz);
+			}
+			if (n != 0 && (Uint) high - (Uint) low < 3 * n) {
+			    /* dense: jump table */
+			    c[-1] = SWITCH_DENSE;
+			    *c++ = low;
+			    *c++ = (Uint) high - (Uint) low + 1;
+			    *f++ = c - code;
+			    *c++ = dflt = FETCH2U(pc, u);
+			    for (slot = 0; n != 0; --n) {
+				num = caseValue(pc, sz);
+				high = caseValue(pc + sz, sz);
+				pc += 2 * sz;
+				while (slot < (Uint) num - (Uint) low) {
+				    *f++ = c - code;
+				    *c++ = dflt;
+				    slot++;
+				}
+				FETCH2U(pc, u);
+				while (slot <= (Uint) high - (Uint) low) {
+				    *f++ = c - code;
+				    *c++ = u;
+				    slot++;
+				}
+			    }
+			    break;
+			}
+			*c++ = n;
+			*f++ = c - code;
+			*c++ = FETCH2U(pc, u);
+			while (n != 0) {
+			    *c++ = caseValue(pc, sz);
+			    *c++ = caseValue(pc + sz, sz);
+			    pc += 2 * sz;
+			    *f++ = c - code;
+			    *c++ = FETCH2U(pc, u);
+			    --n;
+			}
+			break;
+
+		    case SWITCH_STRING:
+			count = c++;
+			*f++ = c - code;
+			*c++ = FETCH2U(pc, u);
+			*f++ = c - code;
+			if (FETCH1U(pc) == 0) {
+			    /* nil case */
+			    *c++ = FETCH2U(pc, u);
+			    --n;
+			} else {
+			    *c++ = u;
+			}
+			*count = --n;
+			while (n != 0) {
+			    *c++ = FETCH1U(pc);
+			    *c++ = FETCH2U(pc, u);
+			    *f++ = c - code;
+			    *c++ = FETCH2U(pc, u);
+			    --n;
+			}
+			c = hashCases(ctrl, count + 3, *count, c);
+			break;
+		    }
+		    break;
+
+		case I_CALL_KFUNC:
+		case I_CALL_KFUNC | I_POP_BIT:
+		case I_CALL_EFUNC:
+		case I_CALL_EFUNC | I_POP_BIT:
+		    if ((instr & ~I_POP_BIT) == I_CALL_KFUNC) {
+			u = FETCH1U(pc);
+			n = inlineKfun(u, &c);
+			if (n != 0) {
+			    /* performed by the interpreter */
+			    instr = n | (instr & I_POP_BIT);
+			    break;
+			}
+		    } else {
+			FETCH2U(pc, u);
+		    }
+		    *c++ = u;
+		    if (KFUN(u).func == kf_call_other) {
+			/* call_other gets a call cache */
+			instr = I_CALL_OTHER | (instr & I_POP_BIT);
+			*c++ = FETCH1U(pc);
+			*cc++ = c - code;
+			*c++ = 0;
+		    } else if (PROTO_VARGS(KFUN(u).proto) != 0) {
+			/* variable # of arguments */
+			*c++ = FETCH1U(pc);
+			*c++ = TRUE;
+		    } else {
+			/* fixed # of arguments */
+			*c++ = PROTO_NARGS(KFUN(u).proto);
+			*c++ = FALSE;
+		    }
+		    break;
+
+		case I_CALL_CEFUNC:
+		case I_CALL_CEFUNC | I_POP_BIT:
+		case I_CALL_FUNC:
+		case I_CALL_FUNC | I_POP_BIT:
+		    *c++ = FETCH2U(pc, u);
+		    *c++ = FETCH1U(pc);
+		    break;
+
+		case I_CALL_DFUNC:
+		case I_CALL_DFUNC | I_POP_BIT:
+		    *c++ = FETCH1U(pc);
+		    *c++ = FETCH1U(pc);
+		    *c++ = FETCH1U(pc);
+		    break;
+
+		case I_RLIMITS:
+		    *c++ = FETCH1U(pc);
+		    break;
+		}
+	    }
+	    *start = ((Uint) (pc - prog) << 8) | instr;
+	}
+	map[len] = c - code;
+
+	/* relocate jumps */
+	retry = FALSE;
+	while (f > fix) {
+	    --f;
+	    if (map[code[*f]] == FUSED) {
+		/* jump into a superinstruction: translate again */
+		labels[code[*f]] = TRUE;
+		retry = TRUE;
+	    } else {
+		code[*f] = map[code[*f]];
+	    }
+	}
+    } while (retry);
+    FREE(labels);
+    FREE(fix);
+    FREE(map);
+
+    /* allocate call caches */
+    while (cc > calls) {
+	--cc;
+	code[*cc] = ctrl->addCallCache();
+    }
+    FREE(calls);
+
+    /* shrink to fit */
+    l = c - code;
+    c = ALLOC(Uint, l);
+    memcpy(c, code, l * sizeof(Uint));
+    FREE(code);
+
+    return c;
+}
+
+/*
+ * apply the int kfun of an inline instruction
+ */
+static Int intOp(int kf, Int a, Int b)
+{
+    switch (kf) {
+    case KF_ADD_INT:	return a + b;
+    case KF_AND_INT:	return a & b;
+    case KF_DIV_INT:	return Frame::div(a, b);
+    case KF_EQ_INT:	return (a == b);
+    case KF_GE_INT:	return (a >= b);
+    case KF_GT_INT:	return (a > b);
+    case KF_LE_INT:	return (a <= b);
+    case KF_LSHIFT_INT:	return Frame::lshift(a, b);
+    case KF_LT_INT:	return (a < b);
+    case KF_MOD_INT:	return Frame::mod(a, b);
+    case KF_MULT_INT:	return a * b;
+    case KF_NE_INT:	return (a != b);
+    case KF_OR_INT:	return a | b;
+    case KF_RSHIFT_INT:	return Frame::rshift(a, b);
+    case KF_SUB_INT:	return a - b;
+    case KF_UMIN_INT:	return -a;
+    case KF_XOR_INT:	return a ^ b;
+    default:		return 0;
+    }
+}
+
+# ifdef NATIVEFLOAT
+/*
+ * perform a builtin float kfun on the top of the stack, with host doubles
+ */
+static void fltOp(Frame *f, int kf)
+{
+    double d;
+
+    i_add_ticks(f, 1);
+    switch (kf) {
+    case KF_ADD1_FLT:
+	d = f->sp->flt + 1.0;
+	break;
+
+    case KF_SUB1_FLT:
+	d = f->sp->flt - 1.0;
+	break;
+
+    case KF_NOT_FLT:
+	PUT_INTVAL(f->sp, VFLT_ISZERO(f->sp));
+	return;
+
+    case KF_TST_FLT:
+	PUT_INTVAL(f->sp, !VFLT_ISZERO(f->sp));
+	return;
+
+    case KF_UMIN_FLT:
+	if (!VFLT_ISZERO(f->sp)) {
+	    f->sp->flt = -f->sp->flt;
+	}
+	return;
+
+    default:
+	d = f->sp->flt;
+	f->sp++;
+	switch (kf) {
+	case KF_ADD_FLT:
+	    d = f->sp->flt + d;
 	    break;
 
-	case I_JUMP_ZERO:
-	    p = prog + FETCH2U(pc, u);
+	case KF_DIV_FLT:
+	    if (d == 0.0) {
+		error("Division by zero");
+	    }
+	    d = f->sp->flt / d;
+	    break;
+
+	case KF_MULT_FLT:
+	    d = f->sp->flt * d;
+	    break;
+
+	case KF_SUB_FLT:
+	    d = f->sp->flt - d;
+	    break;
+
+	case KF_EQ_FLT:
+	    PUT_INTVAL(f->sp, (f->sp->flt == d));
+	    return;
+
+	case KF_GE_FLT:
+	    PUT_INTVAL(f->sp, (f->sp->flt >= d));
+	    return;
+
+	case KF_GT_FLT:
+	    PUT_INTVAL(f->sp, (f->sp->flt > d));
+	    return;
+
+	case KF_LE_FLT:
+	    PUT_INTVAL(f->sp, (f->sp->flt <= d));
+	    return;
+
+	case KF_LT_FLT:
+	    PUT_INTVAL(f->sp, (f->sp->flt < d));
+	    return;
+
+	case KF_NE_FLT:
+	    PUT_INTVAL(f->sp, (f->sp->flt != d));
+	    return;
+	}
+	break;
+    }
+    if (!Float::narrow(&d)) {
+	error("Result too large");
+    }
+    f->sp->flt = d;
+}
+# endif
+
+# ifdef INSTRCOUNT
+# define COUNT(instr)	Profile::opcode(instr)
+# else
+# define COUNT(instr)
+# endif
+# ifdef THREADED
+/*
+ * threaded code: every instruction dispatches the next one by itself
+ */
+# ifdef DEBUG
+# define CHECK_STACK()	if (sp < stack + MIN_STACK) {			\
+			    fatal("out of value stack");		\
+			}
+# else
+# define CHECK_STACK()
+# endif
+# define INSTR(op)	case op: L_##op
+# define INSTR_POP(op)	case op: case op | I_POP_BIT: L_##op
+# define NEXT		do {						\
+			    CHECK_STACK();				\
+			    this->dpc = pc;				\
+			    instr = *pc++;				\
+			    COUNT(instr & I_DECODED_MASK);		\
+			    goto *dispatch[instr & I_DECODED_MASK];	\
+			} while (FALSE)
+# define NEXT_POP	do {						\
+			    if (instr & I_POP_BIT) {			\
+				(sp++)->del();				\
+			    }						\
+			    NEXT;					\
+			} while (FALSE)
+# else
+# define INSTR(op)	case op
+# define INSTR_POP(op)	case op: case op | I_POP_BIT
+# define NEXT		continue
+# define NEXT_POP	break
+# endif
+# define LOCAL(n)	(((Int) (n) < 0) ? fp + (Int) (n) : argp + (n))
+
+/*
+ * Main interpreter function. Interpret decoded stack machine code, return
+ * the code following the I_RETURN.
+ */
+Uint *Frame::interpret(Uint *pc)
+{
+    Uint instr, u, u2;
+    Uint *p;
+    char *opc;
+    int size, instance;
+    bool atomic;
+    Value *v, val;
+
+# ifdef THREADED
+# ifndef NATIVEFLOAT
+# define L_I_KFUNC_FLT	L_illegal
+# endif
+    static void *const dispatch[I_DECODED_MASK + 1] = {
+	&&L_I_PUSH_INT1, &&L_I_PUSH_INT4, &&L_I_CALL_OTHER, &&L_I_PUSH_FLOAT6,
+	&&L_I_PUSH_STRING, &&L_I_PUSH_FAR_STRING, &&L_I_PUSH_GLOBAL,
+	&&L_I_INDEX, &&L_I_INDEX2, &&L_I_AGGREGATE, &&L_I_CAST,
+	&&L_I_INSTANCEOF, &&L_I_STORES, &&L_I_STORE_GLOBAL_INDEX,
+	&&L_I_CALL_EFUNC, &&L_I_CALL_CEFUNC, &&L_I_CALL_CKFUNC,
+	&&L_I_STORE_LOCAL, &&L_I_STORE_GLOBAL, &&L_I_STORE_FAR_GLOBAL,
+	&&L_I_STORE_INDEX, &&L_I_STORE_LOCAL_INDEX,
+	&&L_I_STORE_FAR_GLOBAL_INDEX, &&L_I_STORE_INDEX_INDEX,
+	&&L_I_JUMP_ZERO, &&L_I_JUMP, &&L_I_CALL_KFUNC, &&L_I_CALL_AFUNC,
+	&&L_I_CALL_DFUNC, &&L_I_CALL_FUNC, &&L_I_CATCH, &&L_I_RLIMITS,
+
+	&&L_I_PUSH_INT2, &&L_illegal, &&L_I_CALL_OTHER, &&L_illegal,
+	&&L_I_PUSH_NEAR_STRING, &&L_I_PUSH_LOCAL, &&L_I_PUSH_FAR_GLOBAL,
+	&&L_I_INDEX, &&L_I_SPREAD, &&L_I_AGGREGATE, &&L_I_CAST,
+	&&L_I_INSTANCEOF, &&L_I_STORES, &&L_I_STORE_GLOBAL_INDEX,
+	&&L_I_CALL_EFUNC, &&L_I_CALL_CEFUNC, &&L_I_CALL_CKFUNC,
+	&&L_I_STORE_LOCAL, &&L_I_STORE_GLOBAL, &&L_I_STORE_FAR_GLOBAL,
+	&&L_I_STORE_INDEX, &&L_I_STORE_LOCAL_INDEX,
+	&&L_I_STORE_FAR_GLOBAL_INDEX, &&L_I_STORE_INDEX_INDEX,
+	&&L_I_JUMP_NONZERO, &&L_I_SWITCH, &&L_I_CALL_KFUNC, &&L_I_CALL_AFUNC,
+	&&L_I_CALL_DFUNC, &&L_I_CALL_FUNC, &&L_I_CATCH, &&L_I_RETURN,
+
+	&&L_I_ADD_LOCAL, &&L_I_INT_CONST, &&L_I_JUMP_LOCAL,
+	&&L_I_JUMP_LOCAL_INT, &&L_I_INDEX_GLOBAL, &&L_I_KFUNC_INT,
+	&&L_I_KFUNC_FLT, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal,
+
+	&&L_I_ADD_LOCAL, &&L_I_INT_CONST, &&L_illegal, &&L_illegal,
+	&&L_I_INDEX_GLOBAL, &&L_I_KFUNC_INT, &&L_I_KFUNC_FLT, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal,
+	&&L_illegal, &&L_illegal, &&L_illegal, &&L_illegal
+    };
+# endif
+
+    size = 0;
+
+    for (;;) {
+# ifdef DEBUG
+	if (sp < stack + MIN_STACK) {
+	    fatal("out of value stack");
+	}
+# endif
+	this->dpc = pc;
+	instr = *pc++;
+	COUNT(instr & I_DECODED_MASK);
+
+	switch (instr & I_DECODED_MASK) {
+	INSTR(I_PUSH_INT1):
+	INSTR(I_PUSH_INT2):
+	INSTR(I_PUSH_INT4):
+	    PUSH_INTVAL(this, *pc++);
+	    NEXT;
+
+	INSTR(I_PUSH_FLOAT6):
+	    PUSH_FLTCONST(this, pc[0], pc[1]);
+	    pc += 2;
+	    NEXT;
+
+	INSTR(I_PUSH_STRING):
+	INSTR(I_PUSH_NEAR_STRING):
+	INSTR(I_PUSH_FAR_STRING):
+	    PUSH_STRVAL(this, p_ctrl->strconst(pc[0], pc[1]));
+	    pc += 2;
+	    NEXT;
+
+	INSTR(I_PUSH_LOCAL):
+	    pushValue(((Int) *pc < 0) ? fp + (Int) *pc : argp + *pc);
+	    pc++;
+	    NEXT;
+
+	INSTR(I_PUSH_GLOBAL):
+	INSTR(I_PUSH_FAR_GLOBAL):
+	    pushValue(global(pc[0], pc[1]));
+	    pc += 2;
+	    NEXT;
+
+	INSTR_POP(I_INDEX):
+	    index(sp + 1, sp, &val, FALSE);
+	    *++sp = val;
+	    NEXT_POP;
+
+	INSTR(I_INDEX2):
+	    index(sp + 1, sp, &val, TRUE);
+	    *--sp = val;
+	    NEXT;
+
+	INSTR_POP(I_AGGREGATE):
+	    if (pc[0] == 0) {
+		aggregate(pc[1]);
+	    } else {
+		mapAggregate(pc[1]);
+	    }
+	    pc += 2;
+	    NEXT_POP;
+
+	INSTR(I_SPREAD):
+	    size = spread(-(Int) *pc++ - 2);
+	    NEXT;
+
+	INSTR_POP(I_CAST):
+	    cast(sp, pc[0], pc[1]);
+	    pc += 2;
+	    NEXT_POP;
+
+	INSTR_POP(I_INSTANCEOF):
+	    instance = instanceOf(*pc++);
+	    PUT_INTVAL(sp, instance);
+	    NEXT_POP;
+
+	INSTR_POP(I_STORES):
+	    u = pc[0];
+	    this->pc = prog + (instr >> 8);
+	    this->dpc = (Uint *) NULL;
+	    if (kflv) {
+		kflv = FALSE;
+		lvalues(u);
+	    } else {
+		if (sp->type != T_ARRAY) {
+		    error("Value is not an array");
+		}
+		if (u > sp->array->size) {
+		    error("Wrong number of lvalues");
+		}
+		Dataspace::elts(sp->array);
+		stores(0, u);
+	    }
+	    pc = code + pc[1];
+	    NEXT_POP;
+
+	INSTR_POP(I_STORE_LOCAL):
+	    if ((Int) *pc >= 0) {
+		storeParam(*pc, sp);
+	    } else {
+		storeLocal(-(Int) *pc, sp);
+	    }
+	    pc++;
+	    NEXT_POP;
+
+	INSTR_POP(I_STORE_GLOBAL):
+	INSTR_POP(I_STORE_FAR_GLOBAL):
+	    storeGlobal(pc[0], pc[1], sp);
+	    pc += 2;
+	    NEXT_POP;
+
+	INSTR_POP(I_STORE_INDEX):
+	    storeIndex(sp);
+	    NEXT_POP;
+
+	INSTR_POP(I_STORE_LOCAL_INDEX):
+	    if ((Int) *pc >= 0) {
+		storeParamIndex(*pc, sp);
+	    } else {
+		storeLocalIndex(-(Int) *pc, sp);
+	    }
+	    pc++;
+	    NEXT_POP;
+
+	INSTR_POP(I_STORE_GLOBAL_INDEX):
+	INSTR_POP(I_STORE_FAR_GLOBAL_INDEX):
+	    storeGlobalIndex(pc[0], pc[1], sp);
+	    pc += 2;
+	    NEXT_POP;
+
+	INSTR_POP(I_STORE_INDEX_INDEX):
+	    storeIndexIndex(sp);
+	    NEXT_POP;
+
+	INSTR(I_JUMP_ZERO):
+	    p = code + *pc++;
 	    if (!VAL_TRUE(sp)) {
 		if (p < pc) {
 		    loop_ticks(this);
@@ -1869,10 +2704,10 @@ void Frame::interpret(char *pc)
 		pc = p;
 	    }
 	    (sp++)->del();
-	    continue;
+	    NEXT;
 
-	case I_JUMP_NONZERO:
-	    p = prog + FETCH2U(pc, u);
+	INSTR(I_JUMP_NONZERO):
+	    p = code + *pc++;
 	    if (VAL_TRUE(sp)) {
 		if (p < pc) {
 		    loop_ticks(this);
@@ -1880,28 +2715,33 @@ void Frame::interpret(char *pc)
 		pc = p;
 	    }
 	    (sp++)->del();
-	    continue;
+	    NEXT;
 
-	case I_JUMP:
-	    p = prog + FETCH2U(pc, u);
+	INSTR(I_JUMP):
+	    p = code + *pc;
 	    if (p < pc) {
 		loop_ticks(this);
 	    }
 	    pc = p;
-	    continue;
+	    NEXT;
 
-	case I_SWITCH:
-	    switch (FETCH1U(pc)) {
+	INSTR(I_SWITCH):
+	    switch (*pc) {
 	    case SWITCH_INT:
-		p = prog + switchInt(pc);
+		p = code + switchInt(pc + 1);
 		break;
 
 	    case SWITCH_RANGE:
-		p = prog + switchRange(pc);
+		p = code + switchRange(pc + 1);
 		break;
 
 	    case SWITCH_STRING:
-		p = prog + switchStr(pc);
+		p = code + switchStr(pc + 1);
+		break;
+
+	    case SWITCH_DENSE:
+		u = (Uint) sp->number - pc[1];
+		p = code + ((sp->type == T_INT && u < pc[2]) ? pc[4 + u] : pc[3]);
 		break;
 	    }
 	    if (p < pc) {
@@ -1909,99 +2749,77 @@ void Frame::interpret(char *pc)
 	    }
 	    pc = p;
 	    (sp++)->del();
-	    continue;
+	    NEXT;
 
-	case I_CALL_KFUNC:
-	case I_CALL_KFUNC | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    kf = &KFUN(u);
-	    if (PROTO_VARGS(kf->proto) != 0) {
+	INSTR_POP(I_CALL_KFUNC):
+	INSTR_POP(I_CALL_EFUNC):
+	    u = pc[0];
+	    if (pc[2]) {
 		/* variable # of arguments */
-		u2 = FETCH1U(pc) + size;
+		u2 = pc[1] + size;
 		size = 0;
 	    } else {
 		/* fixed # of arguments */
-		u2 = PROTO_NARGS(kf->proto);
+		u2 = pc[1];
 	    }
-	    this->pc = pc;
+	    pc += 3;
+	    this->pc = opc = prog + (instr >> 8);
 	    kfunc(u, u2);
-	    pc = this->pc;
-	    break;
-
-	case I_CALL_EFUNC:
-	case I_CALL_EFUNC | I_POP_BIT:
-	    FETCH2U(pc, u);
-	    kf = &KFUN(u);
-	    if (PROTO_VARGS(kf->proto) != 0) {
-		/* variable # of arguments */
-		u2 = FETCH1U(pc) + size;
-		size = 0;
-	    } else {
-		/* fixed # of arguments */
-		u2 = PROTO_NARGS(kf->proto);
+	    if (this->pc != opc) {
+		/* the kfun performed the following stores */
+		pc = code + pc[2];
 	    }
-	    this->pc = pc;
-	    kfunc(u, u2);
-	    pc = this->pc;
-	    break;
+	    NEXT_POP;
 
-	case I_CALL_CKFUNC:
-	case I_CALL_CKFUNC | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    u2 = FETCH1U(pc) + size;
+	INSTR_POP(I_CALL_OTHER):
+	    u = pc[0];
+	    u2 = pc[1] + size;
 	    size = 0;
-	    this->pc = pc;
+	    pc += 3;
+	    this->pc = prog + (instr >> 8);
 	    kfunc(u, u2);
-	    pc = this->pc;
-	    break;
+	    NEXT_POP;
 
-	case I_CALL_CEFUNC:
-	case I_CALL_CEFUNC | I_POP_BIT:
-	    FETCH2U(pc, u);
-	    u2 = FETCH1U(pc) + size;
+	INSTR_POP(I_CALL_CKFUNC):
+	INSTR_POP(I_CALL_CEFUNC):
+	    u = pc[0];
+	    u2 = pc[1] + size;
 	    size = 0;
-	    this->pc = pc;
+	    pc += 2;
 	    kfunc(u, u2);
-	    pc = this->pc;
-	    break;
+	    NEXT_POP;
 
-	case I_CALL_AFUNC:
-	case I_CALL_AFUNC | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    funcall((Object *) NULL, (Array *) NULL, 0, u, FETCH1U(pc) + size);
+	INSTR_POP(I_CALL_AFUNC):
+	    funcall((Object *) NULL, (Array *) NULL, 0, pc[0], pc[1] + size);
+	    pc += 2;
 	    size = 0;
-	    break;
+	    NEXT_POP;
 
-	case I_CALL_DFUNC:
-	case I_CALL_DFUNC | I_POP_BIT:
-	    u = FETCH1U(pc);
-	    u2 = FETCH1U(pc);
+	INSTR_POP(I_CALL_DFUNC):
 	    funcall((Object *) NULL, (Array *) NULL,
-		    UCHAR(ctrl->imap[p_index + u]), u2, FETCH1U(pc) + size);
+		    UCHAR(ctrl->imap[p_index + pc[0]]), pc[1], pc[2] + size);
+	    pc += 3;
 	    size = 0;
-	    break;
+	    NEXT_POP;
 
-	case I_CALL_FUNC:
-	case I_CALL_FUNC | I_POP_BIT:
-	    FETCH2U(pc, u);
-	    vfunc(u, FETCH1U(pc) + size);
+	INSTR_POP(I_CALL_FUNC):
+	    vfunc(pc[0], pc[1] + size);
+	    pc += 2;
 	    size = 0;
-	    break;
+	    NEXT_POP;
 
-	case I_CATCH:
-	case I_CATCH | I_POP_BIT:
+	INSTR_POP(I_CATCH):
 	    atomic = this->atomic;
-	    p = prog + FETCH2U(pc, u);
+	    p = code + *pc++;
 	    try {
 		ErrorContext::push((ErrorContext::Handler) runtimeError);
 		this->atomic = FALSE;
-		interpret(pc);
+		pc = interpret(pc);
 		ErrorContext::pop();
-		pc = this->pc;
 		*--sp = Value::nil;
 	    } catch (...) {
 		/* error */
-		this->pc = p;
+		this->dpc = pc - 2;
 		if (p < pc) {
 		    loop_ticks(this);
 		}
@@ -2009,22 +2827,87 @@ void Frame::interpret(char *pc)
 		PUSH_STRVAL(this, ErrorContext::exception());
 	    }
 	    this->atomic = atomic;
-	    break;
+	    NEXT_POP;
 
-	case I_RLIMITS:
-	    rlimits(FETCH1U(pc));
-	    interpret(pc);
-	    pc = this->pc;
+	INSTR(I_RLIMITS):
+	    rlimits(*pc++);
+	    pc = interpret(pc);
 	    setRlimits(rlim->next);
-	    continue;
+	    NEXT;
 
-	case I_RETURN:
-	    return;
+	INSTR_POP(I_ADD_LOCAL):
+	    v = LOCAL(pc[0]);
+	    PUT_INT(v, v->number + (Int) pc[1]);
+	    v->modified = TRUE;
+	    pc += 2;
+	    if (!(instr & I_POP_BIT)) {
+		pushValue(v);
+	    }
+	    NEXT;
+
+	INSTR_POP(I_INT_CONST):
+	    PUT_INT(sp, intOp(pc[0], sp->number, (Int) pc[1]));
+	    pc += 2;
+	    NEXT_POP;
+
+	INSTR_POP(I_KFUNC_INT):
+	    sp++;
+	    PUT_INT(sp, intOp(*pc++, sp->number, sp[-1].number));
+	    NEXT_POP;
+
+# ifdef NATIVEFLOAT
+	INSTR_POP(I_KFUNC_FLT):
+	    fltOp(this, *pc++);
+	    NEXT_POP;
+# endif
+
+	INSTR(I_JUMP_LOCAL):
+	    if (intOp(pc[2], LOCAL(pc[0])->number, LOCAL(pc[1])->number)) {
+		p = code + pc[3];
+		if (p < pc) {
+		    loop_ticks(this);
+		}
+		pc = p;
+	    } else {
+		pc += 4;
+	    }
+	    NEXT;
+
+	INSTR(I_JUMP_LOCAL_INT):
+	    if (intOp(pc[2], LOCAL(pc[0])->number, (Int) pc[1])) {
+		p = code + pc[3];
+		if (p < pc) {
+		    loop_ticks(this);
+		}
+		pc = p;
+	    } else {
+		pc += 4;
+	    }
+	    NEXT;
+
+	INSTR_POP(I_INDEX_GLOBAL):
+	    v = global(pc[0], pc[1]);
+	    if ((v->type == T_ARRAY || v->type == T_STRING) &&
+		LOCAL(pc[2])->type == T_INT) {
+		index(v, LOCAL(pc[2]), &val, TRUE);
+		*--sp = val;
+	    } else {
+		pushValue(v);
+		pushValue(LOCAL(pc[2]));
+		index(sp + 1, sp, &val, FALSE);
+		*++sp = val;
+	    }
+	    pc += 3;
+	    NEXT_POP;
+
+	INSTR(I_RETURN):
+	    return pc;
 
-# ifdef DEBUG
 	default:
-	    fatal("illegal instruction");
+# ifdef THREADED
+	L_illegal:
 # endif
+	    fatal("illegal instruction");
 	}
 
 	if (instr & I_POP_BIT) {
@@ -2048,6 +2931,10 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
     bool ellipsis;
     Value val;
 
+    if (Profile::pending) {
+	Profile::sample(this);
+    }
+
     f.prev = this;
     if (oindex == OBJ_NONE) {
 	/*
@@ -2110,7 +2997,8 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
     f.func = &f.p_ctrl->funcs()[funci];
     if (f.func->sclass & C_UNDEFINED) {
 	error("Undefined function %s",
-	      f.p_ctrl->strconst(f.func->inherit, f.func->index)->text);
+	      (char *) f.p_ctrl->strconst(f.func->inherit,
+					  f.func->index)->text);
     }
 
     pc = f.p_ctrl->program() + f.func->offset;
@@ -2129,7 +3017,8 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
 	/* if fewer actual than formal parameters, check for varargs */
 	if (nargs < PROTO_NARGS(pc) && stricttc) {
 	    error("Insufficient arguments for function %s",
-		  f.p_ctrl->strconst(f.func->inherit, f.func->index)->text);
+		  (char *) f.p_ctrl->strconst(f.func->inherit,
+					      f.func->index)->text);
 	}
 
 	/* add missing arguments */
@@ -2189,7 +3078,8 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
     } else if (nargs > n) {
 	if (stricttc) {
 	    error("Too many arguments for function %s",
-		  f.p_ctrl->strconst(f.func->inherit, f.func->index)->text);
+		  (char *) f.p_ctrl->strconst(f.func->inherit,
+					      f.func->index)->text);
 	}
 
 	/* pop superfluous arguments */
@@ -2201,6 +3091,9 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
     }
     f.sp = sp;
     f.nargs = nargs;
+    f.pc = (char *) NULL;
+    f.source = 0;
+    f.dpc = (Uint *) NULL;
     cframe = &f;
     if (f.lwobj != (Array *) NULL) {
 	f.lwobj->ref();
@@ -2245,11 +3138,16 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
     f.ctrl->funCalls();	/* make sure they are available */
 
     /* execute code */
-    f.source = 0;
     if (!ext_execute(&f, funci)) {
-	f.prog = pc += 2;
-	f.interpret(pc);
+	f.prog = pc + 2;
+	f.code = f.p_ctrl->code(funci);
+	f.interpret(f.code);
     }
+# ifdef INSTRCOUNT
+    if (oindex == OBJ_NONE) {
+	Profile::idle();	/* end of task */
+    }
+# endif
     val = *f.sp++;
 
     /* clean up stack, move return value to outer stackframe */
@@ -2287,7 +3185,7 @@ void Frame::funcall(Object *obj, Array *lwobj, int p_ctrli, int funci,
  * Attempt to call a function in an object. Return TRUE if the call succeeded.
  */
 bool Frame::call(Object *obj, Array *lwobj, const char *func, unsigned int len,
-		 int call_static, int nargs)
+		 int call_static, int nargs, CallCache *cache)
 {
     Symbol *symb;
     FuncDef *fdef;
@@ -2360,7 +3258,7 @@ bool Frame::call(Object *obj, Array *lwobj, const char *func, unsigned int len,
 
     /* find the function in the symbol table */
     ctrl = obj->control();
-    symb = ctrl->symb(func, len);
+    symb = ctrl->symb(func, len, cache);
     if (symb == (Symbol *) NULL) {
 	/* function doesn't exist in symbol table */
 	pop(nargs);
@@ -2383,23 +3281,43 @@ bool Frame::call(Object *obj, Array *lwobj, const char *func, unsigned int len,
     return TRUE;
 }
 
+/*
+ * return the call cache of the call_other being executed, if any
+ */
+CallCache *Frame::callCache()
+{
+    if (dpc != (Uint *) NULL &&
+	(*dpc & I_DECODED_MASK & ~I_POP_BIT) == I_CALL_OTHER) {
+	return p_ctrl->callCache(dpc[3]);
+    }
+    return (CallCache *) NULL;
+}
+
 /*
  * return the line number the program counter of the specified frame is at
  */
 unsigned short Frame::line()
 {
-    char *pc, *numbers;
+    char *pc, *end, *numbers;
     int instr;
     short offset;
     unsigned short line, u, sz;
 
+    if (dpc != (Uint *) NULL) {
+	/* the decoded instruction holds the offset of the next one */
+	end = prog + (*dpc >> 8);
+    } else {
+	/* performing stores */
+	end = this->pc;
+    }
+
     line = 0;
     pc = p_ctrl->prog + func->offset;
     pc += PROTO_SIZE(pc) + 3;
     FETCH2U(pc, u);
     numbers = pc + u;
 
-    while (pc < this->pc) {
+    while (pc < end) {
 	instr = FETCH1U(pc);
 
 	offset = instr >> I_LINE_SHIFT;
@@ -2556,7 +3474,7 @@ Array *Frame::funcTrace(Dataspace *data)
     unsigned short n;
     Value *args;
     Array *a;
-    unsigned short max_args;
+    asizet max_args;
 
     max_args = conf_array_size() - 5;
 
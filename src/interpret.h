@@ -22,6 +22,7 @@
 # define I_PUSH_INT1		0x00	/* 1 signed */
 # define I_PUSH_INT2		0x20	/* 2 signed */
 # define I_PUSH_INT4		0x01	/* 4 signed */
+# define I_CALL_OTHER		0x02	/* decoded call_other with call cache */
 # define I_PUSH_INT8		0x21	/* reserved */
 # define I_PUSH_FLOAT6		0x03	/* 6 unsigned */
 # define I_PUSH_FLOAT12		0x23	/* reserved */
@@ -61,6 +62,15 @@
 # define I_RLIMITS		0x1f
 # define I_RETURN		0x3f
 
+# define I_ADD_LOCAL		0x40	/* decoded local += constant */
+# define I_INT_CONST		0x41	/* decoded int kfun with constant */
+# define I_JUMP_LOCAL		0x42	/* decoded compare locals and jump */
+# define I_JUMP_LOCAL_INT	0x43	/* decoded compare local and jump */
+# define I_INDEX_GLOBAL		0x44	/* decoded global indexed by local */
+# define I_KFUNC_INT		0x45	/* decoded inline int kfun */
+# define I_KFUNC_FLT		0x46	/* decoded inline native float kfun */
+# define I_DECODED_MASK		0x7f	/* decoded instruction mask */
+
 # define I_LINE_MASK		0xc0	/* line add bits */
 # define I_POP_BIT		0x20	/* pop 1 after instruction */
 # define I_LINE_SHIFT		6
@@ -89,10 +99,75 @@
 				 v |= UCHAR(*(pc)++), v <<= 8, \
 				 v |= UCHAR(*(pc)++)))
 
+# ifdef COMPACTVALUE
+/*
+ * store type and contents with a single write, keeping the dirty bit
+ */
+# define VAL_SET(v, t, x)	((v)->bits = VAL_MODIFIED(v) | VAL_BITS(t, x))
+# define VAL_PUSH(f, t, x)	((--(f)->sp)->bits = VAL_BITS(t, x))
+# define VAL_FLT(h, l)		(((Uuint) (h) << 32) | (l))
+# define VAL_OBJ(o)		(((Uuint) (o)->index << 32) | (o)->count)
+# define VAL_STR(s)		((uintptr_t) (String *) (s))
+# define VAL_ARR(a)		((uintptr_t) (Array *) (a))
+
+# define PUSH_INTVAL(f, i)	VAL_PUSH(f, T_INT, (Uint) (i))
+# define PUT_INTVAL(v, i)	VAL_SET(v, T_INT, (Uint) (i))
+# define PUT_INT(v, i)		((v)->number = (i))
+# define PUSH_FLTVAL(f, fl)	VAL_PUSH(f, T_FLOAT,				\
+					 VAL_FLT((fl).high, (fl).low))
+# define PUSH_FLTCONST(f, h, l)	VAL_PUSH(f, T_FLOAT, VAL_FLT(h, l))
+# define PUT_FLTVAL(v, fl)	VAL_SET(v, T_FLOAT,				\
+					VAL_FLT((fl).high, (fl).low))
+# define PUT_FLT(v, fl)		((v)->oindex = (fl).high,		\
+				 (v)->objcnt = (fl).low)
+# define GET_FLT(v, fl)		((fl).high = (v)->oindex,		\
+				 (fl).low = (v)->objcnt)
+# define PUSH_STRVAL(f, s)	(VAL_PUSH(f, T_STRING, VAL_STR(s)),	\
+				 (f)->sp->string->ref())
+# define PUT_STRVAL(v, s)	(VAL_SET(v, T_STRING, VAL_STR(s)),	\
+				 (v)->string->ref())
+# define PUT_STRVAL_NOREF(v, s)	VAL_SET(v, T_STRING, VAL_STR(s))
+# define PUT_STR(v, s)		(((v)->string = (s))->ref())
+# define PUSH_OBJVAL(f, o)	VAL_PUSH(f, T_OBJECT, VAL_OBJ(o))
+# define PUT_OBJVAL(v, o)	VAL_SET(v, T_OBJECT, VAL_OBJ(o))
+# define PUT_OBJ(v, o)		((v)->oindex = (o)->index,		\
+				 (v)->objcnt = (o)->count)
+# define PUSH_ARRVAL(f, a)	(VAL_PUSH(f, T_ARRAY, VAL_ARR(a)),	\
+				 (f)->sp->array->ref())
+# define PUT_ARRVAL(v, a)	(VAL_SET(v, T_ARRAY, VAL_ARR(a)),	\
+				 (v)->array->ref())
+# define PUT_ARRVAL_NOREF(v, a)	VAL_SET(v, T_ARRAY, VAL_ARR(a))
+# define PUT_ARR(v, a)		(((v)->array = (a))->ref())
+# define PUSH_MAPVAL(f, m)	(VAL_PUSH(f, T_MAPPING, VAL_ARR(m)),	\
+				 (f)->sp->array->ref())
+# define PUT_MAPVAL(v, m)	(VAL_SET(v, T_MAPPING, VAL_ARR(m)),	\
+				 (v)->array->ref())
+# define PUT_MAPVAL_NOREF(v, m)	VAL_SET(v, T_MAPPING, VAL_ARR(m))
+# define PUT_MAP(v, m)		(((v)->array = (m))->ref())
+# define PUSH_LWOVAL(f, o)	(VAL_PUSH(f, T_LWOBJECT, VAL_ARR(o)),	\
+				 (f)->sp->array->ref())
+# define PUT_LWOVAL(v, o)	(VAL_SET(v, T_LWOBJECT, VAL_ARR(o)),	\
+				 (v)->array->ref())
+# define PUT_LWOVAL_NOREF(v, o)	VAL_SET(v, T_LWOBJECT, VAL_ARR(o))
+# define PUT_LWO(v, o)		(((v)->array = (o))->ref())
+# else
 # define PUSH_INTVAL(f, i)	((--(f)->sp)->number = (i),		\
 				 (f)->sp->type = T_INT)
 # define PUT_INTVAL(v, i)	((v)->number = (i), (v)->type = T_INT)
 # define PUT_INT(v, i)		((v)->number = (i))
+# ifdef NATIVEFLOAT
+# define PUSH_FLTVAL(f, fl)	((--(f)->sp)->fbits =			\
+					    FLOAT_BITS((fl).high, (fl).low), \
+				 (f)->sp->type = T_FLOAT)
+# define PUSH_FLTCONST(f, h, l)	((--(f)->sp)->fbits = FLOAT_BITS(h, l),	\
+				 (f)->sp->type = T_FLOAT)
+# define PUT_FLTVAL(v, fl)	((v)->fbits =				\
+					    FLOAT_BITS((fl).high, (fl).low), \
+				 (v)->type = T_FLOAT)
+# define PUT_FLT(v, fl)		((v)->fbits = FLOAT_BITS((fl).high, (fl).low))
+# define GET_FLT(v, fl)		((fl).high = FLOAT_HIGH((v)->fbits),	\
+				 (fl).low = FLOAT_LOW((v)->fbits))
+# else
 # define PUSH_FLTVAL(f, fl)	((--(f)->sp)->oindex = (fl).high,	\
 				 (f)->sp->objcnt = (fl).low,		\
 				 (f)->sp->type = T_FLOAT)
@@ -106,6 +181,7 @@
 				 (v)->objcnt = (fl).low)
 # define GET_FLT(v, fl)		((fl).high = (v)->oindex,		\
 				 (fl).low = (v)->objcnt)
+# endif
 # define PUSH_STRVAL(f, s)	(((--(f)->sp)->string = (s))->ref(),	\
 				 (f)->sp->type = T_STRING)
 # define PUT_STRVAL(v, s)	(((v)->string = (s))->ref(),		\
@@ -138,10 +214,17 @@
 				 (v)->type = T_LWOBJECT)
 # define PUT_LWOVAL_NOREF(v, o)	((v)->array = (o), (v)->type = T_LWOBJECT)
 # define PUT_LWO(v, o)		(((v)->array = (o))->ref())
+# endif
 
+# ifdef NATIVEFLOAT
+# define VFLT_ISZERO(v)	(FLOAT_HIGH((v)->fbits) == 0)
+# define VFLT_ISONE(v)	((v)->fbits == FLOAT_BITS(0x3ff0, 0))
+# define VFLT_HASH(v)	(FLOAT_HIGH((v)->fbits) ^ FLOAT_LOW((v)->fbits))
+# else
 # define VFLT_ISZERO(v)	FLOAT_ISZERO((v)->oindex, (v)->objcnt)
 # define VFLT_ISONE(v)	FLOAT_ISONE((v)->oindex, (v)->objcnt)
 # define VFLT_HASH(v)	((v)->oindex ^ (v)->objcnt)
+# endif
 
 # define DESTRUCTED(v)	(OBJR((v)->oindex)->count != (v)->objcnt)
 
@@ -159,6 +242,7 @@
 # define SWITCH_INT	0
 # define SWITCH_RANGE	1
 # define SWITCH_STRING	2
+# define SWITCH_DENSE	3	/* decoded jump table */
 
 
 struct RLInfo {
@@ -169,6 +253,8 @@ struct RLInfo {
     RLInfo *next;		/* next in linked list */
 };
 
+struct CallCache;
+
 class Frame {
 public:
     void growStack(int);
@@ -207,12 +293,14 @@ public:
     void rlimits(bool privileged);
     void funcall(Object *obj, Array *lwobj, int p_ctrli, int funci, int nargs);
     bool call(Object *obj, Array *lwobj, const char *func, unsigned int len,
-	      int call_static, int nargs);
+	      int call_static, int nargs, CallCache *cache = NULL);
+    CallCache *callCache();
     bool callTraceI(Int idx, Value *v);
     Array *callTrace();
     bool callCritical(const char *func, int narg, int flag);
     void atomicError(Int level);
     Frame *restore(Int level);
+    unsigned short line();
 
     static void init(char *create, bool flag);
     static int instanceOf(unsigned int oindex, char *prog);
@@ -221,6 +309,7 @@ public:
     static Int mod(Int num, Int denom);
     static Int rshift(Int num, Int shift);
     static void runtimeError(Frame *f, Int depth);
+    static Uint *decode(Control *ctrl, char *pc);
     static void clear();
 
     Frame *prev;		/* previous stack frame */
@@ -256,11 +345,10 @@ private:
     void newRlimits(Int depth, Int t);
     void typecheck(Frame *f, const char *name, const char *ftype, char *proto,
 		   int nargs, bool strict);
-    unsigned short switchInt(char *pc);
-    unsigned short switchRange(char *pc);
-    unsigned short switchStr(char *pc);
-    void interpret(char *pc);
-    unsigned short line();
+    Uint switchInt(Uint *pc);
+    Uint switchRange(Uint *pc);
+    Uint switchStr(Uint *pc);
+    Uint *interpret(Uint *pc);
     Array *funcTrace(Dataspace *data);
 
     static int instanceOf(unsigned int oindex, char *prog, Uint hash);
@@ -269,6 +357,8 @@ private:
     bool sos;			/* stack on stack */
     uindex foffset;		/* program function offset */
     char *prog;			/* start of program */
+    Uint *code;			/* start of decoded program */
+    Uint *dpc;			/* decoded program counter */
     Value *stack;		/* local value stack */
 };
 
@@ -277,6 +367,7 @@ extern Frame *cframe;
 # define i_add_ticks(f, t)	((f)->rlim->ticks -= (t))
 # define loop_ticks(f)							\
     do {								\
+	(f)->p_ctrl->nloops++;						\
 	if (((f)->rlim->ticks -= 5) <= 0) {				\
 	    if ((f)->rlim->noticks) {					\
 		(f)->rlim->ticks = 0x7fffffff;				\
@@ -284,4 +375,7 @@ extern Frame *cframe;
 		error("Out of ticks");					\
 	    }								\
 	}								\
+	if (Profile::pending) {						\
+	    Profile::sample(f);						\
+	}								\
     } while (FALSE)
@@ -3228,7 +3228,7 @@ int kf_sum(Frame *f, int nargs, kfunc *kf)
 	    if (v->number < 0) {
 		error("Bad argument 1 for kfun allocate");
 	    }
-	    if (v->number > conf_array_size()) {
+	    if (v->number > (Int) conf_array_size()) {
 		error("Array too large");
 	    }
 	    size += v->number;
@@ -3240,7 +3240,7 @@ int kf_sum(Frame *f, int nargs, kfunc *kf)
 	    if (v->number < 0) {
 		error("Bad argument 1 for kfun allocate_int");
 	    }
-	    if (v->number > conf_array_size()) {
+	    if (v->number > (Int) conf_array_size()) {
 		error("Array too large");
 	    }
 	    size += v->number;
@@ -3252,7 +3252,7 @@ int kf_sum(Frame *f, int nargs, kfunc *kf)
 	    if (v->number < 0) {
 		error("Bad argument 1 for kfun allocate_float");
 	    }
-	    if (v->number > conf_array_size()) {
+	    if (v->number > (Int) conf_array_size()) {
 		error("Array too large");
 	    }
 	    size += v->number;
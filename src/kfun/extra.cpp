@@ -661,7 +661,8 @@ no_match:
     top[1].string->del();
     PUT_INTVAL(&top[1], matches);
     top[0].string->del();
-    memmove(f->sp + 1, f->sp, (top - f->sp) * sizeof(Value));
+    memmove((void *) (f->sp + 1), f->sp,
+	    (top - f->sp) * sizeof(Value));
 
     PUT_ARRVAL(f->sp, a);
     f->kflv = TRUE;
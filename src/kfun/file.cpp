@@ -23,6 +23,7 @@
 # include "kfun.h"
 # include "path.h"
 # include "editor.h"
+# include "profile.h"
 # endif
 
 # ifdef FUNCDEF
@@ -718,7 +719,7 @@ static char *restore_mapping	(restcontext*, char*, Value*);
  */
 static char *restore_array(restcontext *x, char *buf, Value *val)
 {
-    unsigned short i;
+    asizet i;
     Value *v;
     Array *a;
 
@@ -770,7 +771,7 @@ static char *restore_array(restcontext *x, char *buf, Value *val)
  */
 static char *restore_mapping(restcontext *x, char *buf, Value *val)
 {
-    unsigned short i;
+    asizet i;
     Value *v;
     Array *a;
 
@@ -1183,6 +1184,74 @@ int kf_write_file(Frame *f, int nargs, kfunc *kf)
 # endif
 
 
+# ifdef FUNCDEF
+FUNCDEF("dump_profile", kf_dump_profile, pt_dump_profile, 0)
+# else
+char pt_dump_profile[] = { C_TYPECHECKED | C_STATIC, 1, 1, 0, 8, T_INT,
+			   T_STRING, T_INT };
+
+/*
+ * NAME:	kfun->dump_profile()
+ * DESCRIPTION:	write the profiler samples to a file
+ */
+int kf_dump_profile(Frame *f, int nargs, kfunc *kf)
+{
+    char file[STRINGSZ];
+    bool clear;
+
+    UNREFERENCED_PARAMETER(kf);
+
+    clear = (nargs > 1 && (f->sp++)->number != 0);
+    if (Path::string(file, f->sp->string->text,
+		     f->sp->string->len) == (char *) NULL) {
+	return 1;
+    }
+    if (f->level != 0) {
+	error("dump_profile() within atomic function");
+    }
+
+    i_add_ticks(f, 1000);
+    f->sp->string->del();
+    PUT_INTVAL(f->sp, Profile::dump(file, clear));
+    return 0;
+}
+# endif
+
+
+# ifdef FUNCDEF
+FUNCDEF("dump_allocations", kf_dump_allocations, pt_dump_allocations, 0)
+# else
+char pt_dump_allocations[] = { C_TYPECHECKED | C_STATIC, 1, 1, 0, 8, T_INT,
+			       T_STRING, T_INT };
+
+/*
+ * NAME:	kfun->dump_allocations()
+ * DESCRIPTION:	write the allocation samples to a file
+ */
+int kf_dump_allocations(Frame *f, int nargs, kfunc *kf)
+{
+    char file[STRINGSZ];
+    bool clear;
+
+    UNREFERENCED_PARAMETER(kf);
+
+    clear = (nargs > 1 && (f->sp++)->number != 0);
+    if (Path::string(file, f->sp->string->text,
+		     f->sp->string->len) == (char *) NULL) {
+	return 1;
+    }
+    if (f->level != 0) {
+	error("dump_allocations() within atomic function");
+    }
+
+    i_add_ticks(f, 1000);
+    f->sp->string->del();
+    PUT_INTVAL(f->sp, Profile::dumpAllocs(file, clear));
+    return 0;
+}
+# endif
+
+
 # ifdef FUNCDEF
 FUNCDEF("read_file", kf_read_file, pt_read_file, 0)
 # else
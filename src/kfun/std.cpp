@@ -157,7 +157,7 @@ int kf_call_other(Frame *f, int nargs, kfunc *kf)
     }
 
     if (f->call(obj, lwobj, val[-1].string->text, val[-1].string->len, FALSE,
-		nargs - 2)) {
+		nargs - 2, f->callCache())) {
 	val = f->sp++;		/* function exists */
     } else {
 	val = &Value::nil;	/* function doesn't exist */
@@ -899,7 +899,7 @@ char pt_sizeof[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_INT,
  */
 int kf_sizeof(Frame *f, int n, kfunc *kf)
 {
-    unsigned short size;
+    asizet size;
 
     UNREFERENCED_PARAMETER(n);
     UNREFERENCED_PARAMETER(kf);
@@ -976,7 +976,7 @@ char pt_map_sizeof[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7, T_INT,
  */
 int kf_map_sizeof(Frame *f, int n, kfunc *kf)
 {
-    unsigned short size;
+    asizet size;
 
     UNREFERENCED_PARAMETER(n);
     UNREFERENCED_PARAMETER(kf);
@@ -1567,6 +1567,47 @@ int kf_status(Frame *f, int nargs, kfunc *kf)
 # endif
 
 
+# ifdef FUNCDEF
+FUNCDEF("memory_top", kf_memory_top, pt_memory_top, 0)
+# else
+char pt_memory_top[] = { C_TYPECHECKED | C_STATIC, 1, 0, 0, 7,
+			 T_OBJECT | (1 << REFSHIFT), T_INT };
+
+/*
+ * NAME:	kfun->memory_top()
+ * DESCRIPTION:	return the objects in memory which use the most memory
+ */
+int kf_memory_top(Frame *f, int nargs, kfunc *kf)
+{
+    Int n;
+    Sector count, m;
+
+    UNREFERENCED_PARAMETER(nargs);
+    UNREFERENCED_PARAMETER(kf);
+
+    n = f->sp->number;
+    if (n < 0) {
+	return 1;
+    }
+    count = Dataspace::dcount();
+    if (n > (Int) conf_array_size()) {
+	n = conf_array_size();
+    }
+    if ((Uint) n > count) {
+	n = count;
+    }
+
+    /* all dataspaces in memory are sorted, whatever the number returned */
+    i_add_ticks(f, 1000 + n);
+    for (m = count; m != 0; m >>= 1) {
+	i_add_ticks(f, count);
+    }
+    PUT_ARRVAL(f->sp, Dataspace::memoryTop(f->data, n));
+    return 0;
+}
+# endif
+
+
 # ifdef CLOSURES
 # ifdef FUNCDEF
 FUNCDEF("new.function", kf_new_function, pt_new_function, 0)
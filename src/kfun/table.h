@@ -45,6 +45,7 @@ extern int  kf_ckrangeft(Frame*, int, kfunc*);
 extern int  kf_ckrangef	(Frame*, int, kfunc*);
 extern int  kf_ckranget	(Frame*, int, kfunc*);
 extern int  kf_nil	(Frame*, int, kfunc*);
+extern int  kf_call_other(Frame*, int, kfunc*);
 extern int  kf_unused	(Frame*, int, kfunc*);
 extern void kf_init	();
 extern void kf_jit	();
@@ -666,8 +666,11 @@ void Object::upgrade(Control *ctrl, Frame *f)
     obj->prev = prev;
     prev = obj->index;
 
-    /* remove references to old inherited objects */
+    /* call sites must look up functions in the old program again */
     ctrl = control();
+    ctrl->flushCalls();
+
+    /* remove references to old inherited objects */
     for (i = ctrl->ninherits, inh = ctrl->inherits; --i > 0; inh++) {
 	obj = OBJW(inh->oindex);
 	if (--(obj->ref) == 0) {
@@ -1014,7 +1014,8 @@ String *parse_grammar(String *gram)
 	     * end of grammar
 	     */
 	    if (tmplist != (rule *) NULL) {
-		sprintf(buffer, "Undefined symbol %s", tmplist->symb->text);
+		sprintf(buffer, "Undefined symbol %s",
+			(char *) tmplist->symb->text);
 		goto err;
 	    }
 	    if (rgxlist == (rule *) NULL) {
@@ -690,7 +690,7 @@ static Int ps_traverse(parser *ps, pnode *pn, pnode *next)
 	    if (n != 1) {
 		ac_add(&ps->arrc, a = Array::create(ps->data, n));
 		v = a->elts;
-		memset(v, '\0', n * sizeof(Value));
+		memset((void *) v, '\0', n * sizeof(Value));
 	    }
 	    for (sub = pn->list, i = n; i != 0; sub = sub->next) {
 		if (sub->symbol != PN_BLOCKED) {
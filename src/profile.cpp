@@ -0,0 +1,538 @@
+/*
+ * This file is part of DGD, https://github.com/dworkin/dgd
+ * Copyright (C) 1993-2010 Dworkin B.V.
+ * Copyright (C) 2010-2019 DGD Authors (see the commit log for details)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+# define INCLUDE_FILE_IO
+# include "dgd.h"
+# include "hash.h"
+# include "str.h"
+# include "array.h"
+# include "object.h"
+# include "xfloat.h"
+# include "control.h"
+# include "data.h"
+# include "interpret.h"
+# include "table.h"
+# include "profile.h"
+
+/*
+ * A sampling profiler.  A host timer sets a flag, and the interpreter takes
+ * the sample at the next function call or loop iteration.  Samples are kept
+ * as a histogram of call stacks in the collapsed format used by flame graph
+ * tools: frames from the outermost inwards, separated by semicolons.
+ *
+ * Allocations are sampled as well, once per so many bytes.  The memory
+ * manager reports the sample with its C++ call site, and the LPC frame is
+ * recorded in a form that can be taken without allocating memory.  Names
+ * are looked up later, at a safe point or at the end of the task.
+ */
+
+# define PROFTABSZ	1024		/* profile hash table size */
+# define PROFSTACKSZ	4096		/* max length of a call stack */
+# define PROFDEPTH	64		/* max # frames in a call stack */
+# define PROFMAX	16384		/* max # different call stacks */
+# define ALLOCBUFSZ	64		/* max # unresolved allocation samples */
+# define PCHUNKSZ	128
+
+class ProfEntry : public Hashtab::Entry, public ChunkAllocated {
+public:
+    Uint count;			/* # samples of this call stack */
+    Uuint bytes;		/* estimated # bytes allocated */
+};
+
+static class ProfChunk : public Chunk<ProfEntry, PCHUNKSZ> {
+public:
+    /*
+     * free call stacks when iterating through items
+     */
+    virtual bool item(ProfEntry *e) {
+	FREE((char *) e->name);
+	return TRUE;
+    }
+} pchunk, achunk;
+
+struct AllocSample {
+    void *site;			/* C++ call site */
+    size_t bytes;		/* bytes represented by the sample */
+    uindex oindex;		/* object, or OBJ_NONE */
+    uindex program;		/* program of the function */
+    char inherit;		/* function name inherit index */
+    unsigned short index;	/* function name index */
+    unsigned short line;	/* line number */
+};
+
+static Hashtab *ptab;		/* call stack histogram */
+static Uint interval;		/* microseconds between samples */
+static Uint nsamples;		/* # samples taken */
+static Uint nstacks;		/* # different call stacks */
+static Uint ndropped;		/* # samples not recorded */
+static volatile bool ticked;	/* timer expired */
+static Hashtab *atab;		/* allocation histogram */
+static Uint nsites;		/* # different allocation sites */
+static Uuint adropped;		/* # allocated bytes not recorded */
+static AllocSample allocs[ALLOCBUFSZ];	/* unresolved allocation samples */
+static unsigned int nallocs;	/* # unresolved allocation samples */
+volatile bool Profile::pending;	/* sample at the next safe point */
+# ifdef INSTRCOUNT
+Uuint Profile::stamp;			/* cycles at last instruction */
+int Profile::current;			/* last instruction */
+Uuint Profile::icount[I_DECODED_MASK + 1];	/* instructions executed */
+Uuint Profile::icycles[I_DECODED_MASK + 1];	/* cycles per instruction */
+Uuint Profile::kfcount[KFTAB_SIZE];	/* kfun calls */
+Uuint Profile::kfcycles[KFTAB_SIZE];	/* cycles per kfun */
+# endif
+
+/*
+ * initialize the profiler, taking rate samples per second of CPU time, and
+ * one allocation sample per the given number of bytes
+ */
+void Profile::init(unsigned int rate, Uint bytes)
+{
+    if (rate != 0) {
+	interval = 1000000 / rate;
+	clear();
+	P_profile(interval, &tick);
+    }
+    if (bytes != 0) {
+	clearAllocs();
+	Alloc::sample(bytes, &allocation);
+    }
+}
+
+/*
+ * request a sample
+ */
+void Profile::tick()
+{
+    ticked = TRUE;
+    pending = TRUE;
+}
+
+/*
+ * append a name to a call stack, replacing the separators of the collapsed
+ * format
+ */
+static char *append(char *p, const char *name, char *end)
+{
+    while (*name != '\0' && p < end) {
+	*p++ = (*name == ';' || *name == ' ') ? '_' : *name;
+	name++;
+    }
+    return p;
+}
+
+/*
+ * append a function as /object(/program)::function
+ */
+static char *function(char *p, Object *obj, Object *prog, const char *func,
+		      char *end)
+{
+    const char *name;
+
+    name = (obj->name != (char *) NULL) ? obj->name : OBJR(obj->master)->name;
+    p = append(p, "/", end);
+    p = append(p, name, end);
+    if (strcmp(name, prog->name) != 0) {
+	p = append(p, "(/", end);
+	p = append(p, prog->name, end);
+	p = append(p, ")", end);
+    }
+    p = append(p, "::", end);
+    return append(p, func, end);
+}
+
+/*
+ * find or create the histogram entry for a key, or return NULL if the
+ * histogram is full
+ */
+static ProfEntry *entry(Hashtab *tab, ProfChunk *chunk, Uint *n,
+			const char *key)
+{
+    Hashtab::Entry **h;
+    ProfEntry *e;
+
+    h = tab->lookup(key, TRUE);
+    if (*h == (Hashtab::Entry *) NULL) {
+	if (*n == PROFMAX) {
+	    return (ProfEntry *) NULL;
+	}
+	Alloc::staticMode();
+	e = chunknew (*chunk) ProfEntry;
+	e->name = strcpy(ALLOC(char, strlen(key) + 1), key);
+	Alloc::dynamicMode();
+	e->next = (Hashtab::Entry *) NULL;
+	e->count = 0;
+	e->bytes = 0;
+	*h = e;
+	(*n)++;
+    }
+    return (ProfEntry *) *h;
+}
+
+/*
+ * add the current call stack to the histogram
+ */
+void Profile::sample(Frame *f)
+{
+    char buffer[PROFSTACKSZ + 16];
+    Frame *frames[PROFDEPTH];
+    char *p, *end;
+    int n;
+    ProfEntry *e;
+
+    if (nallocs != 0) {
+	flush();
+    }
+    pending = FALSE;
+    if (!ticked) {
+	return;
+    }
+    if (f->oindex == OBJ_NONE) {
+	pending = TRUE;
+	return;		/* not running LPC code */
+    }
+    ticked = FALSE;
+    if (ptab == (Hashtab *) NULL) {
+	return;
+    }
+    nsamples++;
+
+    for (n = 0; f->oindex != OBJ_NONE && n < PROFDEPTH; f = f->prev) {
+	frames[n++] = f;
+    }
+
+    p = buffer;
+    end = buffer + PROFSTACKSZ;
+    if (f->oindex != OBJ_NONE) {
+	p = append(p, "[truncated]", end);
+	*p++ = ';';
+    }
+    while (n != 0) {
+	f = frames[--n];
+	p = function(p, OBJR(f->oindex), OBJR(f->p_ctrl->oindex),
+		     f->p_ctrl->strconst(f->func->inherit,
+					 f->func->index)->text,
+		     end);
+	if (n != 0 && p < end) {
+	    *p++ = ';';
+	}
+    }
+    /* the line executing in the innermost frame */
+    sprintf(p, ":%u", (f->source != 0) ? f->source : f->line());
+
+    e = entry(ptab, &pchunk, &nstacks, buffer);
+    if (e == (ProfEntry *) NULL) {
+	ndropped++;
+    } else {
+	e->count++;
+    }
+}
+
+/*
+ * record an allocation sample, called from the memory manager.  Nothing
+ * is done that could allocate memory or load a program
+ */
+void Profile::allocation(size_t bytes, void *site)
+{
+    Frame *f;
+    AllocSample *s;
+
+    if (nallocs == ALLOCBUFSZ) {
+	adropped += bytes;
+	return;
+    }
+    s = &allocs[nallocs++];
+    s->site = site;
+    s->bytes = bytes;
+    f = cframe;
+    if (f == (Frame *) NULL || f->oindex == OBJ_NONE) {
+	s->oindex = OBJ_NONE;
+    } else {
+	s->oindex = f->oindex;
+	s->program = f->p_ctrl->oindex;
+	s->inherit = f->func->inherit;
+	s->index = f->func->index;
+	s->line = (f->source != 0) ? f->source : f->line();
+    }
+    pending = TRUE;
+}
+
+/*
+ * add the pending allocation samples to the histogram, as the LPC frame
+ * followed by the C++ call site
+ */
+void Profile::flush()
+{
+    char buffer[PROFSTACKSZ + STRINGSZ + 16];
+    char *p;
+    unsigned int i;
+    AllocSample *s;
+    Object *prog;
+    ProfEntry *e;
+
+    /* samples taken meanwhile are appended and handled as well */
+    for (i = 0; i < nallocs; i++) {
+	s = &allocs[i];
+	p = buffer;
+	if (s->oindex == OBJ_NONE) {
+	    p = append(p, "[driver]", buffer + PROFSTACKSZ);
+	} else {
+	    prog = OBJR(s->program);
+	    p = function(p, OBJR(s->oindex), prog,
+			 prog->control()->strconst(s->inherit,
+						   s->index)->text,
+			 buffer + PROFSTACKSZ);
+	    p += sprintf(p, ":%u", s->line);
+	}
+	*p++ = ';';
+	P_daddr(s->site, p);
+
+	e = entry(atab, &achunk, &nsites, buffer);
+	if (e == (ProfEntry *) NULL) {
+	    adropped += s->bytes;
+	} else {
+	    e->count++;
+	    e->bytes += s->bytes;
+	}
+    }
+    nallocs = 0;
+}
+
+/*
+ * return the number of samples taken
+ */
+Uint Profile::samples()
+{
+    return nsamples;
+}
+
+/*
+ * remove all samples
+ */
+void Profile::clear()
+{
+    if (ptab != (Hashtab *) NULL) {
+	delete ptab;
+	pchunk.items();
+	pchunk.clean();
+    }
+    Alloc::staticMode();
+    ptab = Hashtab::create(PROFTABSZ, PROFSTACKSZ, FALSE);
+    Alloc::dynamicMode();
+    nsamples = nstacks = ndropped = 0;
+}
+
+/*
+ * remove all allocation samples
+ */
+void Profile::clearAllocs()
+{
+    if (atab != (Hashtab *) NULL) {
+	delete atab;
+	achunk.items();
+	achunk.clean();
+    }
+    Alloc::staticMode();
+    atab = Hashtab::create(PROFTABSZ, PROFSTACKSZ, FALSE);
+    Alloc::dynamicMode();
+    nsites = 0;
+    adropped = 0;
+}
+
+/*
+ * write a histogram to a file in collapsed stack format, with either the
+ * number of samples or the number of bytes, and return the number of lines
+ * written, or -1 if the file could not be written
+ */
+static long histogram(char *file, Hashtab *tab, Uuint dropped, bool bytes)
+{
+    char buffer[PROFSTACKSZ + STRINGSZ + 48];
+    Hashtab::Entry **t, *e;
+    Uint i;
+    long n;
+    int fd, len;
+
+    fd = P_open(file, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0664);
+    if (fd < 0) {
+	return -1;
+    }
+
+    n = 0;
+    if (tab != (Hashtab *) NULL) {
+	for (i = tab->size(), t = tab->table(); i != 0; --i, t++) {
+	    for (e = *t; e != (Hashtab::Entry *) NULL; e = e->next) {
+		len = sprintf(buffer, "%s %llu\012", e->name,
+			      (bytes) ?
+			       (unsigned long long) ((ProfEntry *) e)->bytes :
+			       (unsigned long long) ((ProfEntry *) e)->count);
+		if (P_write(fd, buffer, len) != len) {
+		    P_close(fd);
+		    return -1;
+		}
+		n++;
+	    }
+	}
+	if (dropped != 0) {
+	    len = sprintf(buffer, "[dropped] %llu\012",
+			  (unsigned long long) dropped);
+	    if (P_write(fd, buffer, len) != len) {
+		P_close(fd);
+		return -1;
+	    }
+	    n++;
+	}
+    }
+    P_close(fd);
+
+    return n;
+}
+
+/*
+ * write the call stack histogram to a file, and return the number of call
+ * stacks written, or -1 if the file could not be created
+ */
+long Profile::dump(char *file, bool clear)
+{
+    long n;
+
+    n = histogram(file, ptab, ndropped, FALSE);
+    if (n >= 0 && clear && ptab != (Hashtab *) NULL) {
+	Profile::clear();
+    }
+    return n;
+}
+
+/*
+ * write the allocation histogram to a file, with the estimated number of
+ * bytes allocated at each LPC line and C++ call site, and return the number
+ * of lines written, or -1 if the file could not be created
+ */
+long Profile::dumpAllocs(char *file, bool clear)
+{
+    long n;
+
+    flush();
+    n = histogram(file, atab, adropped, TRUE);
+    if (n >= 0 && clear && atab != (Hashtab *) NULL) {
+	clearAllocs();
+    }
+    return n;
+}
+
+/*
+ * stop profiling
+ */
+void Profile::finish()
+{
+    if (interval != 0) {
+	P_profile(0, &tick);
+	interval = 0;
+    }
+    if (ptab != (Hashtab *) NULL) {
+	delete ptab;
+	pchunk.items();
+	pchunk.clean();
+	ptab = (Hashtab *) NULL;
+    }
+    Alloc::sample(0, &allocation);
+    if (atab != (Hashtab *) NULL) {
+	delete atab;
+	achunk.items();
+	achunk.clean();
+	atab = (Hashtab *) NULL;
+    }
+}
+
+# ifdef INSTRCOUNT
+/*
+ * store a counter as a float, which unlike an int will not overflow
+ */
+static void putCount(Value *v, Uuint n)
+{
+    Float f1, f2;
+
+    Float::itof((Int) (n >> 31), &f1);
+    f1.ldexp(31);
+    Float::itof((Int) (n & 0x7fffffff), &f2);
+    f1.add(f2);
+    PUT_FLTVAL(v, f1);
+}
+# endif
+
+/*
+ * return the instruction counters: an array indexed by decoded opcode, with
+ * ({ executions, cycles }) for each executed instruction, or nil if this is
+ * not an instrumented build
+ */
+void Profile::opcodes(Dataspace *data, Value *v)
+{
+# ifdef INSTRCOUNT
+    Array *a, *b;
+    int i;
+
+    a = Array::createNil(data, I_DECODED_MASK + 1);
+    PUT_ARRVAL(v, a);
+    for (i = 0, v = a->elts; i <= I_DECODED_MASK; i++, v++) {
+	if (icount[i] != 0) {
+	    b = Array::create(data, 2);
+	    PUT_ARRVAL(v, b);
+	    putCount(&b->elts[0], icount[i]);
+	    putCount(&b->elts[1], icycles[i]);
+	}
+    }
+# else
+    UNREFERENCED_PARAMETER(data);
+    *v = Value::nil;
+# endif
+}
+
+/*
+ * return the kfun counters: an array with ({ name, calls, cycles }) for each
+ * kfun called, or nil if this is not an instrumented build.  The cycles
+ * include those of any LPC code called by the kfun
+ */
+void Profile::kfuns(Dataspace *data, Value *v)
+{
+# ifdef INSTRCOUNT
+    Array *a, *b;
+    int i, n;
+
+    for (i = n = 0; i < nkfun; i++) {
+	if (kfcount[i] != 0) {
+	    n++;
+	}
+    }
+    a = Array::create(data, n);
+    PUT_ARRVAL(v, a);
+    for (i = 0, v = a->elts; n != 0; i++) {
+	if (kfcount[i] != 0) {
+	    b = Array::create(data, 3);
+	    PUT_ARRVAL(v, b);
+	    PUT_STRVAL(&b->elts[0], String::create(kftab[i].name,
+						   strlen(kftab[i].name)));
+	    putCount(&b->elts[1], kfcount[i]);
+	    putCount(&b->elts[2], kfcycles[i]);
+	    v++;
+	    --n;
+	}
+    }
+# else
+    UNREFERENCED_PARAMETER(data);
+    *v = Value::nil;
+# endif
+}
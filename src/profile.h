@@ -0,0 +1,82 @@
+/*
+ * This file is part of DGD, https://github.com/dworkin/dgd
+ * Copyright (C) 1993-2010 Dworkin B.V.
+ * Copyright (C) 2010-2019 DGD Authors (see the commit log for details)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+class Profile {
+public:
+    static void init(unsigned int rate, Uint bytes);
+    static void sample(Frame *f);
+    static void flush();
+    static Uint samples();
+    static long dump(char *file, bool clear);
+    static long dumpAllocs(char *file, bool clear);
+    static void finish();
+    static void opcodes(Dataspace *data, Value *v);
+    static void kfuns(Dataspace *data, Value *v);
+
+# ifdef INSTRCOUNT
+    /*
+     * count an instruction, and charge the cycles since the previous one
+     */
+    static void opcode(int instr) {
+	Uuint now;
+
+	now = P_cycles();
+	if (stamp != 0) {
+	    icycles[current] += now - stamp;
+	}
+	stamp = now;
+	icount[current = instr]++;
+    }
+
+    /*
+     * stop charging cycles to the current instruction
+     */
+    static void idle() {
+	if (stamp != 0) {
+	    icycles[current] += P_cycles() - stamp;
+	    stamp = 0;
+	}
+    }
+
+    /*
+     * count a kfun call
+     */
+    static void kfun(int n, Uuint cycles) {
+	kfcount[n]++;
+	kfcycles[n] += cycles;
+    }
+# endif
+
+    static volatile bool pending;	/* sample at the next safe point */
+
+private:
+    static void tick();
+    static void clear();
+    static void allocation(size_t bytes, void *site);
+    static void clearAllocs();
+
+# ifdef INSTRCOUNT
+    static Uuint stamp;				/* cycles at last instruction */
+    static int current;				/* last instruction */
+    static Uuint icount[I_DECODED_MASK + 1];	/* instructions executed */
+    static Uuint icycles[I_DECODED_MASK + 1];	/* cycles per instruction */
+    static Uuint kfcount[KFTAB_SIZE];		/* kfun calls */
+    static Uuint kfcycles[KFTAB_SIZE];		/* cycles per kfun */
+# endif
+};
@@ -24,16 +24,143 @@
 # include "data.h"
 
 # define STR_CHUNK	128
+# define ROPE_MIN	256	/* shortest concatenation to build lazily */
+# define SLICE_MIN	256	/* shortest substring to share */
+# define INTERN_MAX	32	/* longest string to intern */
+# define INTERN_INIT	1024	/* initial intern table size */
 
 struct StrHash : public Hashtab::Entry, public ChunkAllocated {
     String *str;		/* string entry */
     Uint index;			/* building index */
 };
 
+struct StrConcat : public ChunkAllocated {
+    String *left;		/* left part */
+    String *right;		/* right part */
+    Uint depth;			/* depth of concatenation tree */
+};
+
 static Chunk<String, STR_CHUNK> schunk;
 static Chunk<StrHash, STR_CHUNK> hchunk;
+static Chunk<StrConcat, STR_CHUNK> cchunk;
+static Chunk<StrSlice, STR_CHUNK> slchunk;
 
 static Hashtab *sht;		/* string merge table */
+static String **itab;		/* intern table */
+static Uint itabsize;		/* intern table size */
+static Uint icount;		/* # strings in intern table */
+
+/*
+ * NAME:	strhash()
+ * DESCRIPTION:	compute the hash of a text, FNV-1a
+ */
+static Uint strhash(const char *p, ssizet n)
+{
+    Uint h;
+
+    h = 2166136261U;
+    while (n != 0) {
+	h = (h ^ UCHAR(*p++)) * 16777619;
+	--n;
+    }
+    return (h != 0) ? h : 1;
+}
+
+/*
+ * NAME:	ifind()
+ * DESCRIPTION:	find a text in the intern table, or the free slot where it
+ *		should go
+ */
+static Uint ifind(const char *text, ssizet len, Uint hashval)
+{
+    Uint i;
+    String *str;
+
+    for (i = hashval & (itabsize - 1); (str = itab[i]) != (String *) NULL;
+	 i = (i + 1) & (itabsize - 1)) {
+	if (str->hashval == hashval && str->len == len &&
+	    memcmp(str->text.chars(), text, len) == 0) {
+	    break;
+	}
+    }
+    return i;
+}
+
+/*
+ * NAME:	igrow()
+ * DESCRIPTION:	create or double the intern table
+ */
+static void igrow()
+{
+    String **otab;
+    Uint osize, i, j;
+
+    otab = itab;
+    osize = itabsize;
+    itabsize = (osize == 0) ? INTERN_INIT : osize << 1;
+    itab = ALLOC(String*, itabsize);
+    memset(itab, '\0', itabsize * sizeof(String *));
+    for (i = 0; i < osize; i++) {
+	if (otab[i] != (String *) NULL) {
+	    for (j = otab[i]->hashval & (itabsize - 1);
+		 itab[j] != (String *) NULL; j = (j + 1) & (itabsize - 1))
+		;
+	    itab[j] = otab[i];
+	}
+    }
+    if (otab != (String **) NULL) {
+	FREE(otab);
+    }
+}
+
+/*
+ * NAME:	iadd()
+ * DESCRIPTION:	add a string to the intern table, at the slot found by
+ *		ifind()
+ */
+static void iadd(String *str, Uint i)
+{
+    if (2 * (icount + 1) > itabsize) {
+	igrow();
+	i = ifind(str->text.chars(), str->len, str->hashval);
+    }
+    itab[i] = str;
+    icount++;
+    str->interned = TRUE;
+}
+
+/*
+ * NAME:	unintern()
+ * DESCRIPTION:	remove a string from the intern table.  The table is freed
+ *		when it becomes empty, as it does when everything is swapped
+ *		out.
+ */
+static void unintern(String *str)
+{
+    Uint i, j, k, mask;
+
+    mask = itabsize - 1;
+    for (i = str->hashval & mask; itab[i] != str; i = (i + 1) & mask)
+	;
+    for (j = i; ; ) {
+	j = (j + 1) & mask;
+	if (itab[j] == (String *) NULL) {
+	    break;
+	}
+	/* move back any string that cannot be found past the gap */
+	k = itab[j]->hashval & mask;
+	if ((j > i) ? (k <= i || k > j) : (k <= i && k > j)) {
+	    itab[i] = itab[j];
+	    i = j;
+	}
+    }
+    itab[i] = (String *) NULL;
+    if (--icount == 0) {
+	FREE(itab);
+	itab = (String **) NULL;
+	itabsize = 0;
+    }
+}
 
 
 String::String(const char *text, long len)
@@ -44,12 +171,157 @@ String::String(const char *text, long len)
     }
     this->text[this->len = len] = '\0';
     refCount = 0;
+    hashval = 0;
+    interned = FALSE;
+    primary = (StrRef *) NULL;
+}
+
+/*
+ * create the concatenation of two strings, without building its text
+ */
+String::String(String *left, String *right)
+{
+    StrConcat *concat;
+    Uint ldepth, rdepth;
+
+    concat = chunknew (cchunk) StrConcat;
+    (concat->left = left)->ref();
+    (concat->right = right)->ref();
+    ldepth = left->depth();
+    rdepth = right->depth();
+    concat->depth = ((ldepth > rdepth) ? ldepth : rdepth) + 1;
+    text.ptr = (char *) concat + 1;
+    len = left->len + right->len;
+    refCount = 0;
+    hashval = 0;
+    interned = FALSE;
+    primary = (StrRef *) NULL;
+}
+
+/*
+ * create a substring that shares the text of a base string
+ */
+String::String(String *base, char *text, long len)
+{
+    StrSlice *slice;
+
+    slice = chunknew (slchunk) StrSlice;
+    (slice->base = base)->ref();
+    slice->text = text;
+    slice->len = this->len = len;
+    this->text.ptr = (char *) slice + 2;
+    refCount = 0;
+    hashval = 0;
+    interned = FALSE;
     primary = (StrRef *) NULL;
 }
 
 String::~String()
 {
-    FREE(text);
+    StrSlice *slice;
+
+    if (interned) {
+	unintern(this);
+    }
+    slice = text.slice();
+    if (slice != (StrSlice *) NULL) {
+	slice->base->del();
+	delete slice;
+    } else if (text.concat() == (StrConcat *) NULL) {
+	FREE(text.ptr);
+    }
+}
+
+/*
+ * depth of the concatenation tree of a string
+ */
+Uint String::depth()
+{
+    StrConcat *concat;
+
+    concat = text.concat();
+    return (concat != (StrConcat *) NULL) ? concat->depth : 0;
+}
+
+/*
+ * copy the text of a string into a buffer.  Only the shallower part of a
+ * concatenation is handled recursively, so the recursion depth is
+ * logarithmic in the number of parts.
+ */
+void String::fill(char *buf, String *str)
+{
+    StrConcat *concat;
+
+    while ((concat=str->text.concat()) != (StrConcat *) NULL) {
+	if (concat->left->depth() >= concat->right->depth()) {
+	    fill(buf + concat->left->len, concat->right);
+	    str = concat->left;
+	} else {
+	    fill(buf, concat->left);
+	    buf += concat->left->len;
+	    str = concat->right;
+	}
+    }
+    memcpy(buf, str->text.chars(), str->len);
+}
+
+/*
+ * remove a concatenated string that has no references left
+ */
+void String::release(StrConcat *concat)
+{
+    String *str;
+
+    for (;;) {
+	if (concat->left->depth() >= concat->right->depth()) {
+	    concat->right->del();
+	    str = concat->left;
+	} else {
+	    concat->left->del();
+	    str = concat->right;
+	}
+	delete concat;
+
+	if (--str->refCount != 0) {
+	    break;
+	}
+	concat = str->text.concat();
+	delete str;
+	if (concat == (StrConcat *) NULL) {
+	    break;
+	}
+    }
+}
+
+/*
+ * build the text of a concatenated string, or copy the text of a substring
+ */
+void StrText::flatten() const
+{
+    StrSlice *slice;
+    StrConcat *concat;
+    long len;
+    char *text;
+
+    slice = this->slice();
+    if (slice != (StrSlice *) NULL) {
+	text = ALLOC(char, slice->len + 1);
+	memcpy(text, slice->text, slice->len);
+	text[slice->len] = '\0';
+	ptr = text;
+	slice->base->del();
+	delete slice;
+	return;
+    }
+
+    concat = this->concat();
+    len = (long) concat->left->len + concat->right->len;
+    text = ALLOC(char, len + 1);
+    String::fill(text, concat->left);
+    String::fill(text + concat->left->len, concat->right);
+    text[len] = '\0';
+    ptr = text;
+    String::release(concat);
 }
 
 /*
@@ -72,14 +344,70 @@ String *String::create(const char *text, long len)
     return alloc(text, len);
 }
 
+/*
+ * Return the shared string with a given text, creating it if needed.
+ * Only short strings are shared.
+ */
+String *String::intern(const char *text, long len)
+{
+    String *str;
+    Uint h, i;
+
+    if (len > INTERN_MAX) {
+	return create(text, len);
+    }
+    if (itab == (String **) NULL) {
+	igrow();
+    }
+    h = strhash(text, len);
+    i = ifind(text, len, h);
+    if (itab[i] != (String *) NULL) {
+	return itab[i];
+    }
+    str = alloc(text, len);
+    str->hashval = h;
+    iadd(str, i);
+    return str;
+}
+
+/*
+ * Return the shared string equal to a given string.  If there is none, the
+ * string itself is shared from now on, unless it belongs to a dataspace.
+ */
+String *String::intern(String *str)
+{
+    Uint i;
+
+    if (str->interned || str->len > INTERN_MAX) {
+	return str;
+    }
+    if (itab == (String **) NULL) {
+	igrow();
+    }
+    i = ifind(str->text.chars(), str->len, str->hash());
+    if (itab[i] != (String *) NULL) {
+	return itab[i];
+    }
+    if (str->primary == (StrRef *) NULL) {
+	iadd(str, i);
+    }
+    return str;
+}
+
 /*
  * Remove a reference from a string. If there are none left, the string is
  * removed.
  */
 void String::del()
 {
+    StrConcat *concat;
+
     if (--refCount == 0) {
+	concat = text.concat();
 	delete this;
+	if (concat != (StrConcat *) NULL) {
+	    release(concat);
+	}
     }
 }
 
@@ -89,6 +417,8 @@ void String::del()
 void String::clean()
 {
     schunk.clean();
+    cchunk.clean();
+    slchunk.clean();
 }
 
 /*
@@ -106,13 +436,14 @@ void String::merge()
 Uint String::put(Uint n)
 {
     StrHash **h;
+    Uint hash;
 
-    h = (StrHash **) sht->lookup(text, FALSE);
+    hash = this->hash();
+    h = (StrHash **) &sht->table()[hash % sht->size()];
     for (;;) {
 	/*
-	 * The hasher doesn't handle \0 in strings, and so may not have
-	 * found the proper string. Follow the hash table chain until
-	 * the end is reached, or until a match is found using cmp().
+	 * Follow the hash table chain until the end is reached, or until a
+	 * match is found using cmp().
 	 */
 	if (*h == (StrHash *) NULL) {
 	    StrHash *s;
@@ -127,7 +458,7 @@ Uint String::put(Uint n)
 	    s->index = n;
 
 	    return n;
-	} else if (cmp((*h)->str) == 0) {
+	} else if ((*h)->str->hashval == hash && cmp((*h)->str) == 0) {
 	    /* already in the hash table */
 	    return (*h)->index;
 	}
@@ -160,7 +491,6 @@ int String::cmp(String *str)
 	ssizet length;
 	char *p, *q;
 	long cmplen;
-	int cmp;
 
 	cmplen = (long) len - str->len;
 	if (cmplen > 0) {
@@ -174,14 +504,24 @@ int String::cmp(String *str)
 	    }
 	    length = len;
 	}
-	for (p = text, q = str->text; length > 0 && *p == *q;
+	for (p = text.chars(), q = str->text.chars(); length > 0 && *p == *q;
 	     p++, q++, --length)
 	    ;
-	cmp = UCHAR(*p) - UCHAR(*q);
-	return (cmp != 0) ? cmp : cmplen;
+	if (length == 0) {
+	    return cmplen;
+	}
+	return UCHAR(*p) - UCHAR(*q);
     }
 }
 
+/*
+ * compute the hash of a string, over the full text
+ */
+Uint String::rehash()
+{
+    return hashval = strhash(text.chars(), len);
+}
+
 /*
  * add two strings
  */
@@ -189,9 +529,16 @@ String *String::add(String *str)
 {
     String *s;
 
+    if ((long) len + str->len >= ROPE_MIN && len != 0 && str->len != 0) {
+	if ((long) len + str->len > (unsigned long) MAX_STRLEN) {
+	    error("String too long");
+	}
+	return chunknew (schunk) String(this, str);
+    }
+
     s = create((char *) NULL, (long) len + str->len);
-    memcpy(s->text, text, len);
-    memcpy(s->text + len, str->text, str->len);
+    memcpy(s->text, text.chars(), len);
+    memcpy(s->text + len, str->text.chars(), str->len);
 
     return s;
 }
@@ -219,13 +566,26 @@ void String::checkRange(long l1, long l2)
 }
 
 /*
- * return a subrange of a string
+ * Return a subrange of a string.  A long subrange shares the text of the
+ * string, unless that would keep much more text alive than it uses.
  */
 String *String::range(long l1, long l2)
 {
+    StrSlice *slice;
+    String *base;
+    char *p;
+
     if (l1 < 0 || l1 > l2 + 1 || l2 >= (long) len) {
 	error("Invalid string range");
     }
 
-    return create(text + l1, l2 - l1 + 1);
+    p = text.chars() + l1;
+    if (l2 - l1 + 1 >= SLICE_MIN) {
+	slice = text.slice();
+	base = (slice != (StrSlice *) NULL) ? slice->base : this;
+	if (2 * (l2 - l1 + 1) >= (long) base->len) {
+	    return chunknew (schunk) String(base, p, l2 - l1 + 1);
+	}
+    }
+    return create(p, l2 - l1 + 1);
 }
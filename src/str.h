@@ -17,12 +17,70 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+ * a substring that shares the text of another string
+ */
+struct StrSlice : public ChunkAllocated {
+    class String *base;		/* string with the actual text */
+    char *text;			/* start of substring in base text */
+    ssizet len;			/* length of substring */
+};
+
+/*
+ * The text of a string.  The text of a string made by concatenation is
+ * only built when it is first used.  A long substring shares the text of
+ * the string it was taken from, until a '\0'-terminated text is needed.
+ */
+class StrText {
+public:
+    operator char *() const {
+	if ((uintptr_t) ptr & 3) {
+	    flatten();
+	}
+	return ptr;
+    }
+    /*
+     * the characters of the text, not necessarily followed by '\0'
+     */
+    char *chars() const {
+	StrSlice *slice;
+
+	slice = this->slice();
+	return (slice != (StrSlice *) NULL) ? slice->text : (char *) *this;
+    }
+    StrText &operator=(char *text) {
+	ptr = text;
+	return *this;
+    }
+
+private:
+    StrText() { }
+    StrText(const StrText &);
+
+    struct StrConcat *concat() const {
+	return (((uintptr_t) ptr & 3) == 1) ?
+		(struct StrConcat *) (ptr - 1) : (struct StrConcat *) NULL;
+    }
+    StrSlice *slice() const {
+	return (((uintptr_t) ptr & 3) == 2) ?
+		(StrSlice *) (ptr - 2) : (StrSlice *) NULL;
+    }
+    void flatten() const;
+
+    mutable char *ptr;		/* text, or tagged concatenation */
+
+    friend class String;
+};
+
 class String : public ChunkAllocated {
 public:
     ~String();
     void ref() { refCount++; }
     void del();
     int cmp(String *str);
+    Uint hash() {
+	return (hashval != 0) ? hashval : rehash();
+    }
     String *add(String *str);
     ssizet index(long idx);
     void checkRange(long from, long to);
@@ -31,15 +89,28 @@ public:
 
     static String *alloc(const char *text, long length);
     static String *create(const char *text, long length);
+    static String *intern(const char *text, long length);
+    static String *intern(String *str);
     static void clean();
     static void merge();
     static void clear();
 
     struct StrRef *primary;	/* primary reference */
     Uint refCount;		/* number of references */
+    Uint hashval;		/* hash of text, 0 if not yet computed */
     ssizet len;			/* string length */
-    char *text;			/* string text */
+    bool interned;		/* in the intern table? */
+    StrText text;		/* string text */
 
 private:
     String(const char *text, long length);
+    String(String *left, String *right);
+    String(String *base, char *text, long length);
+
+    Uint rehash();
+    Uint depth();
+    static void fill(char *buf, String *str);
+    static void release(struct StrConcat *concat);
+
+    friend class StrText;
 };
@@ -31,6 +31,13 @@ static Sector mfree, sfree;		/* free sector lists */
 static char *cbuf;			/* sector buffer */
 static Sector cached;			/* sector currently cached in cbuf */
 static Swap::SwapSlot *first, *last;	/* first and last swap slot */
+static Swap::SwapSlot *ffirst, *flast;	/* first and last in FIFO */
+static Sector nfifo, maxfifo;		/* # slots in FIFO, max # in FIFO */
+static Sector *ghosts;			/* sectors recently evicted from FIFO */
+static Sector *gmap;			/* sector -> index in ghosts */
+static Sector nghosts, ghost;		/* # ghosts, next ghost to replace */
+static int cpolicy;			/* cache replacement policy */
+static Swap::Info stats;		/* cache statistics */
 static Swap::SwapSlot *lfree;		/* free swap slot list */
 static off_t slotsize;			/* sizeof(SwapSlot) + size of sector */
 static unsigned int sectorsize;		/* size of sector */
@@ -46,7 +53,7 @@ static bool swapping;			/* currently using a swapfile? */
  * initialize the swap device
  */
 void Swap::init(char *file, unsigned int total, unsigned int cache,
-		unsigned int secsize)
+		unsigned int secsize, int policy)
 {
     SwapSlot *h;
     Sector i;
@@ -84,6 +91,27 @@ void Swap::init(char *file, unsigned int total, unsigned int cache,
     /* no swap slots in use yet */
     first = (SwapSlot *) NULL;
     last = (SwapSlot *) NULL;
+    ffirst = (SwapSlot *) NULL;
+    flast = (SwapSlot *) NULL;
+    nfifo = 0;
+
+    cpolicy = policy;
+    if (policy == SP_2Q) {
+	/*
+	 * New sectors enter a FIFO of a quarter of the cache, and only
+	 * move to the LRU list if they are loaded again after having been
+	 * evicted from it, while their number is still remembered.
+	 */
+	maxfifo = (cache + 3) / 4;
+	nghosts = (cache + 1) / 2;
+	ghosts = ALLOC(Sector, nghosts);
+	for (i = 0; i < nghosts; i++) {
+	    ghosts[i] = SW_UNUSED;
+	}
+	ghost = 0;
+	gmap = ALLOC(Sector, total);
+	memset(gmap, '\xff', total * sizeof(Sector));
+    }
 
     swap = dump = -1;
     swapping = TRUE;
@@ -180,6 +208,81 @@ void Swap::newv(Sector *vec, unsigned int size)
     }
 }
 
+/*
+ * remove a swap slot from its list
+ */
+static void detach(Swap::SwapSlot *h)
+{
+    Swap::SwapSlot **f, **l;
+
+    if (h->fifo) {
+	f = &ffirst;
+	l = &flast;
+	--nfifo;
+    } else {
+	f = &first;
+	l = &last;
+    }
+    if (h != *f) {
+	h->prev->next = h->next;
+    } else {
+	*f = h->next;
+	if (*f != (Swap::SwapSlot *) NULL) {
+	    (*f)->prev = (Swap::SwapSlot *) NULL;
+	}
+    }
+    if (h != *l) {
+	h->next->prev = h->prev;
+    } else {
+	*l = h->prev;
+	if (*l != (Swap::SwapSlot *) NULL) {
+	    (*l)->next = (Swap::SwapSlot *) NULL;
+	}
+    }
+}
+
+/*
+ * put a swap slot at the head of the FIFO or the LRU list
+ */
+static void attach(Swap::SwapSlot *h, bool fifo)
+{
+    Swap::SwapSlot **f, **l;
+
+    h->fifo = fifo;
+    if (fifo) {
+	f = &ffirst;
+	l = &flast;
+	nfifo++;
+    } else {
+	f = &first;
+	l = &last;
+    }
+    h->prev = (Swap::SwapSlot *) NULL;
+    h->next = *f;
+    if (*f != (Swap::SwapSlot *) NULL) {
+	(*f)->prev = h;
+    } else {
+	*l = h;		/* last was NULL too */
+    }
+    *f = h;
+}
+
+/*
+ * forget a sector evicted from the FIFO, and return TRUE if it was still
+ * remembered
+ */
+static bool forget(Sector sec)
+{
+    Sector g;
+
+    g = gmap[sec];
+    if (g < nghosts && ghosts[g] == sec) {
+	ghosts[g] = SW_UNUSED;
+	return TRUE;
+    }
+    return FALSE;
+}
+
 /*
  * wipe a vector of sectors
  */
@@ -229,24 +332,9 @@ void Swap::delv(Sector *vec, unsigned int size)
 	if (i < cachesize &&
 	    (h=(SwapSlot *) (mem + i * slotsize))->sec == sec) {
 	    /*
-	     * remove the swap slot from the first-last list
+	     * remove the swap slot from its list
 	     */
-	    if (h != first) {
-		h->prev->next = h->next;
-	    } else {
-		first = h->next;
-		if (first != (SwapSlot *) NULL) {
-		    first->prev = (SwapSlot *) NULL;
-		}
-	    }
-	    if (h != last) {
-		h->next->prev = h->prev;
-	    } else {
-		last = h->prev;
-		if (last != (SwapSlot *) NULL) {
-		    last->next = (SwapSlot *) NULL;
-		}
-	    }
+	    detach(h);
 	    /*
 	     * put the cache slot in the free cache slot list
 	     */
@@ -255,6 +343,10 @@ void Swap::delv(Sector *vec, unsigned int size)
 	    lfree = h;
 	}
 
+	if (cpolicy == SP_2Q) {
+	    forget(sec);
+	}
+
 	/*
 	 * put sec in free sector list
 	 */
@@ -309,6 +401,7 @@ Swap::SwapSlot *Swap::load(Sector sec, bool restore, bool fill)
 	/*
 	 * the sector is either unused or in the swap file
 	 */
+	stats.misses++;
 	if (lfree != (SwapSlot *) NULL) {
 	    /*
 	     * get swap slot from the free swap slot list
@@ -317,16 +410,22 @@ Swap::SwapSlot *Swap::load(Sector sec, bool restore, bool fill)
 	    lfree = h->next;
 	} else {
 	    /*
-	     * No free slot available, use the last one in the swap slot list
-	     * instead.
+	     * No free slot available, use the last one in the FIFO if it has
+	     * grown too large, or the last one in the LRU list otherwise.
 	     */
-	    h = last;
-	    last = h->prev;
-	    if (last != (SwapSlot *) NULL) {
-		last->next = (SwapSlot *) NULL;
+	    if (flast != (SwapSlot *) NULL &&
+		(nfifo > maxfifo || last == (SwapSlot *) NULL)) {
+		h = flast;
+		ghosts[ghost] = h->sec;
+		gmap[h->sec] = ghost;
+		if (++ghost == nghosts) {
+		    ghost = 0;
+		}
 	    } else {
-		first = (SwapSlot *) NULL;
+		h = last;
 	    }
+	    detach(h);
+	    stats.evictions++;
 	    save = h->swap;
 	    if (h->dirty) {
 		/*
@@ -389,35 +488,23 @@ Swap::SwapSlot *Swap::load(Sector sec, bool restore, bool fill)
 	    /* zero-fill new sector */
 	    memset(h + 1, '\0', sectorsize);
 	}
+
+	/*
+	 * With 2Q, a new sector enters the FIFO, unless it was evicted from
+	 * there recently.
+	 */
+	attach(h, (cpolicy == SP_2Q && !forget(sec)));
     } else {
 	/*
-	 * The sector already had a slot. Remove it from the first-last list.
+	 * The sector already had a slot.  Move it to the head of the LRU
+	 * list, unless it is still in the FIFO.
 	 */
-	if (h != first) {
-	    h->prev->next = h->next;
-	} else {
-	    first = h->next;
-	}
-	if (h != last) {
-	    h->next->prev = h->prev;
-	} else {
-	    last = h->prev;
-	    if (last != (SwapSlot *) NULL) {
-		last->next = (SwapSlot *) NULL;
-	    }
+	stats.hits++;
+	if (!h->fifo) {
+	    detach(h);
+	    attach(h, FALSE);
 	}
     }
-    /*
-     * put the sector at the head of the first-last list
-     */
-    h->prev = (SwapSlot *) NULL;
-    h->next = first;
-    if (first != (SwapSlot *) NULL) {
-	first->prev = h;
-    } else {
-	last = h;	/* last was NULL too */
-    }
-    first = h;
 
     return h;
 }
@@ -697,6 +784,14 @@ Sector Swap::count()
     return nsectors - nfree;
 }
 
+/*
+ * return cache statistics
+ */
+Swap::Info *Swap::info()
+{
+    return &stats;
+}
+
 
 struct DumpHeader {
     Uint secsize;		/* size of swap sector */
@@ -723,7 +818,11 @@ int Swap::save(char *snapshot, bool keep)
     }
 
     /* flush the cache and adjust sector map */
-    for (h = last; h != (SwapSlot *) NULL; h = h->prev) {
+    for (n = cachesize, h = (SwapSlot *) mem; n != 0;
+	 --n, h = (SwapSlot *) ((char *) h + slotsize)) {
+	if (h->sec == SW_UNUSED) {
+	    continue;	/* free slot */
+	}
 	sec = h->swap;
 	if (h->dirty) {
 	    /*
@@ -815,9 +914,12 @@ int Swap::save(char *snapshot, bool keep)
     }
 
     /* fix the sector map */
-    for (h = last; h != (SwapSlot *) NULL; h = h->prev) {
-	map[h->sec] = ((intptr_t) h - (intptr_t) mem) / slotsize;
-	h->dirty = FALSE;
+    for (n = cachesize, h = (SwapSlot *) mem; n != 0;
+	 --n, h = (SwapSlot *) ((char *) h + slotsize)) {
+	if (h->sec != SW_UNUSED) {
+	    map[h->sec] = ((intptr_t) h - (intptr_t) mem) / slotsize;
+	    h->dirty = FALSE;
+	}
     }
 
     return swap;
@@ -25,10 +25,20 @@ public:
 	Sector sec;		/* the sector that uses this slot */
 	Sector swap;		/* the swap sector (if any) */
 	bool dirty;		/* has the swap slot been written to? */
+	bool fifo;		/* in the FIFO of newly loaded slots? */
     };
 
+    struct Info {
+	Uint hits;		/* sectors found in the cache */
+	Uint misses;		/* sectors not found in the cache */
+	Uint evictions;		/* swap slots reused */
+    };
+
+# define SP_LRU		0	/* least recently used */
+# define SP_2Q		1	/* 2Q: scan resistant */
+
     static void init(char *file, unsigned int total, unsigned int cache,
-		     unsigned int secsize);
+		     unsigned int secsize, int policy);
     static void finish();
     static bool write(int fd, void *buffer, size_t size);
     static void wipev(Sector *vec, unsigned int size);
@@ -46,6 +56,7 @@ public:
 			    void (*readv) (char*, Sector*, Uint, Uint),
 			    Uint size, Uint offset, Uint *dsize);
     static Sector count();
+    static Info *info();
     static bool copy(Uint);
     static int save(char*, bool);
     static void save2(char*, int, bool);
@@ -72,6 +72,10 @@ public:
     void sinh();
     void tanh();
 
+# ifdef NATIVEFLOAT
+    static bool narrow(double *d);
+# endif
+
     unsigned short high;	/* high word of float */
     Uint low;			/* low longword of float */
 };				/* 1 sign, 11 exponent, 36 mantissa */
@@ -80,4 +84,13 @@ public:
 # define FLOAT_ISONE(h, l)	((h) == 0x3ff0 && (l) == 0L)
 # define FLOAT_ISMONE(h, l)	((h) == 0xbff0 && (l) == 0L)
 
+# ifdef NATIVEFLOAT
+/*
+ * a Float is the high 48 bits of an IEEE double
+ */
+# define FLOAT_BITS(h, l)	(((Uuint) (h) << 48) | ((Uuint) (l) << 16))
+# define FLOAT_HIGH(b)		((unsigned short) ((b) >> 48))
+# define FLOAT_LOW(b)		((Uint) ((b) >> 16))
+# endif
+
 extern Float max_int, thousand, thousandth;
@@ -0,0 +1 @@
+/* inherited by every other object */
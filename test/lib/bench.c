@@ -0,0 +1,88 @@
+# include <status.h>
+
+/*
+ * Driver object for bench.dgd: time an int-heavy and a call-heavy LPC
+ * loop.  In a build with -DINSTRCOUNT, also report the number of LPC
+ * instructions executed per second.
+ */
+
+/*
+ * arithmetic and bit operations on locals
+ */
+int intloop(int n)
+{
+    int i, s;
+
+    for (i = 0; i < n; i++) {
+	s += i & 7;
+	s ^= i << 1;
+    }
+    return s;
+}
+
+/*
+ * function calls
+ */
+int fib(int n)
+{
+    return (n < 2) ? n : fib(n - 1) + fib(n - 2);
+}
+
+/*
+ * total number of instructions executed so far, or nil if not counted
+ */
+static mixed instructions()
+{
+    mixed *counts;
+    float n;
+    int i, sz;
+
+    counts = status()[ST_OPCODES];
+    if (!counts) {
+	return nil;
+    }
+    for (i = 0, sz = sizeof(counts); i < sz; i++) {
+	if (counts[i]) {
+	    n += counts[i][0];
+	}
+    }
+    return n;
+}
+
+/*
+ * run a loop, and report the time it took, and the number of iterations
+ * or calls per second
+ */
+static void bench(string name, string func, int arg, int count)
+{
+    mixed *t1, *t2;
+    mixed n1, n2;
+    float time;
+    string str;
+
+    n1 = instructions();
+    t1 = millitime();
+    call_other(this_object(), func, arg);
+    t2 = millitime();
+    n2 = instructions();
+
+    time = (float) (t2[0] - t1[0]) + (t2[1] - t1[1]);
+    str = name + ": " + time + " s";
+    if (time != 0.0) {
+	str += ", " + (float) count / time + " per second";
+	if (n1 != nil) {
+	    str += ", " + (n2 - n1) + " instructions, " +
+		   (n2 - n1) / time + " per second";
+	}
+    }
+    send_message(str + "\n");
+}
+
+static void initialize()
+{
+    rlimits (0; -1) {
+	bench("int loop", "intloop", 20000000, 20000000);
+	bench("call loop", "fib", 30, 2692537);
+    }
+    shutdown();
+}
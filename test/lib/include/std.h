@@ -0,0 +1 @@
+/* included in every compiled object */
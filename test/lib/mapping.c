@@ -0,0 +1,189 @@
+/*
+ * Driver object for mapping.dgd: compare random inserts, deletes and
+ * lookups in mappings against a plain array, also across an atomic
+ * rollback, and with destructed objects as keys and values.
+ */
+
+# define NKEYS		1000
+
+mapping map;			/* mapping under test */
+mixed *ref;			/* expected value for each key */
+int seed;			/* random seed */
+
+/*
+ * reproducible random number in the range 0 .. n - 1
+ */
+static int rnd(int n)
+{
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return (seed >> 8) % n;
+}
+
+/*
+ * check every key, the size, and the order of indices and values
+ */
+static void check(string tag)
+{
+    int i, n, *indices;
+    mixed *values;
+
+    for (i = n = 0; i < NKEYS; i++) {
+	if (map[i] != ref[i]) {
+	    error(tag + ": key " + i);
+	}
+	if (ref[i] != nil) {
+	    n++;
+	}
+    }
+    if (map_sizeof(map) != n) {
+	error(tag + ": size " + map_sizeof(map) + " instead of " + n);
+    }
+    indices = map_indices(map);
+    values = map_values(map);
+    for (i = 0; i < n; i++) {
+	if (i > 0 && indices[i] <= indices[i - 1]) {
+	    error(tag + ": indices out of order");
+	}
+	if (values[i] != ref[indices[i]]) {
+	    error(tag + ": value of " + indices[i]);
+	}
+    }
+}
+
+/*
+ * change the mapping, then undo everything with an error
+ */
+static atomic void rollback()
+{
+    int i, key;
+
+    for (i = 0; i < 50; i++) {
+	key = rnd(NKEYS);
+	map[key] = (rnd(3) != 0) ? "a" + key : nil;
+    }
+    error("rollback");
+}
+
+/*
+ * random operations on integer keys
+ */
+static void random_keys()
+{
+    int round, i, key;
+
+    map = ([ ]);
+    ref = allocate(NKEYS);
+    for (round = 0; round < 200; round++) {
+	for (i = 0; i < 300; i++) {
+	    key = rnd(NKEYS);
+	    switch (rnd(4)) {
+	    case 0:
+		map[key] = ref[key] = nil;
+		break;
+
+	    case 1:
+		map[key] = ref[key] = key * 3 + round;
+		break;
+
+	    case 2:
+		map[key] = ref[key] = "s" + (key + round);
+		break;
+
+	    default:
+		if (map[key] != ref[key]) {
+		    error("lookup " + key);
+		}
+		break;
+	    }
+	}
+	if (round % 7 == 0) {
+	    check("round " + round);
+	}
+	if (round % 11 == 0) {
+	    catch(rollback());
+	    check("rollback " + round);
+	}
+	if (round % 13 == 0) {
+	    map += ([ ]);
+	}
+    }
+}
+
+/*
+ * string keys, with half of them deleted again
+ */
+static void string_keys()
+{
+    int i;
+
+    map = ([ ]);
+    for (i = 0; i < NKEYS; i++) {
+	map["key" + i] = i;
+    }
+    for (i = 0; i < NKEYS; i += 2) {
+	map["key" + i] = nil;
+    }
+    for (i = 0; i < NKEYS; i++) {
+	if (map["key" + i] != ((i & 1) ? i : nil)) {
+	    error("string key " + i);
+	}
+    }
+    if (map_sizeof(map) != NKEYS / 2) {
+	error("string keys: size " + map_sizeof(map));
+    }
+}
+
+/*
+ * objects as keys and values, with some of them destructed
+ */
+static void object_keys()
+{
+    object master, *objs;
+    int i;
+
+    master = compile_object("/obj");
+    objs = allocate(20);
+    map = ([ ]);
+    for (i = 0; i < 20; i++) {
+	objs[i] = clone_object(master);
+	map[objs[i]] = i;
+	map[i] = objs[i];
+    }
+    for (i = 0; i < 20; i += 2) {
+	destruct_object(objs[i]);
+    }
+    for (i = 1; i < 20; i += 2) {
+	if (map[objs[i]] != i || map[i] != objs[i]) {
+	    error("object key " + i);
+	}
+    }
+    if (map_sizeof(map) != 20) {
+	error("object keys: size " + map_sizeof(map));
+    }
+}
+
+/*
+ * called for runtime errors, which are reported if initialization fails
+ */
+static void runtime_error(string str, int caught, int ticks)
+{
+}
+
+/*
+ * called for errors in atomic code
+ */
+static void atomic_error(string str, int atom, int ticks)
+{
+}
+
+static void initialize()
+{
+    seed = 4711;
+    rlimits (0; -1) {
+	random_keys();
+	string_keys();
+	object_keys();
+    }
+    send_message("mapping: ok\n");
+    shutdown();
+}
@@ -0,0 +1,3 @@
+/*
+ * compiled, cloned and destructed by the tests
+ */
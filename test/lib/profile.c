@@ -0,0 +1,52 @@
+/*
+ * Driver object for profile.dgd: run with both profilers enabled, create
+ * a snapshot, and restore from it.  Shutting down must not crash.
+ */
+
+/*
+ * spend some CPU time allocating memory, so that samples are taken
+ */
+static void work()
+{
+    int i, j;
+    mixed *a;
+
+    for (i = 0; i < 300; i++) {
+	a = allocate(1000);
+	for (j = 0; j < 1000; j++) {
+	    a[j] = j + "";
+	}
+    }
+}
+
+static void initialize()
+{
+    work();
+    send_message("profile: " + dump_profile("/profile.out") +
+		 " call stacks, " + dump_allocations("/alloc.out") +
+		 " allocation sites\n");
+    dump_state();
+    call_out("done", 0);
+}
+
+static void done()
+{
+    shutdown();
+}
+
+void restored()
+{
+    work();
+    send_message("profile: restored\n");
+    shutdown();
+}
+
+string path_read(string path)
+{
+    return path;
+}
+
+string path_write(string path)
+{
+    return path;
+}
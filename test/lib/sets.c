@@ -0,0 +1,158 @@
+/*
+ * Driver object for sets.dgd: compare array subtraction, intersection,
+ * union and exclusive union of random arrays against plain loops.  The
+ * arrays hold integers, floats, strings, arrays, objects and nil, and
+ * now and then an object in them is destructed.
+ */
+
+mixed **arrays;			/* arrays to use as elements */
+object *objects;		/* objects to use as elements */
+int seed;			/* random seed */
+
+/*
+ * reproducible random number in the range 0 .. n - 1
+ */
+static int rnd(int n)
+{
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return (seed >> 8) % n;
+}
+
+/*
+ * a random value, from a range of about n different ones
+ */
+static mixed value(int n)
+{
+    int k;
+
+    k = rnd(n);
+    switch (rnd(7)) {
+    case 0:
+    case 1:
+	return k;
+
+    case 2:
+	return "str" + k;
+
+    case 3:
+	return (float) k / 4.0;
+
+    case 4:
+	return arrays[k % sizeof(arrays)];
+
+    case 5:
+	return objects[k % sizeof(objects)];
+
+    default:
+	return (k & 7) ? k : nil;
+    }
+}
+
+/*
+ * a random array of the given size
+ */
+static mixed *random_array(int size, int n)
+{
+    mixed *a;
+    int i;
+
+    a = allocate(size);
+    for (i = 0; i < size; i++) {
+	a[i] = value(n);
+    }
+    return a;
+}
+
+/*
+ * is the value in the array?
+ */
+static int member(mixed value, mixed *a)
+{
+    int i, sz;
+
+    for (i = 0, sz = sizeof(a); i < sz; i++) {
+	if (a[i] == value) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * the elements of a that are in b, if in is true, or else not in b
+ */
+static mixed *select(mixed *a, mixed *b, int in)
+{
+    mixed *result;
+    int i, sz, n;
+
+    result = allocate(sizeof(a));
+    for (i = n = 0, sz = sizeof(a); i < sz; i++) {
+	if (member(a[i], b) == in) {
+	    result[n++] = a[i];
+	}
+    }
+    return result[.. n - 1];
+}
+
+/*
+ * check that two arrays have the same elements
+ */
+static void compare(mixed *a, mixed *b, string tag)
+{
+    int i, sz;
+
+    if (sizeof(a) != sizeof(b)) {
+	error(tag + ": size " + sizeof(a) + " instead of " + sizeof(b));
+    }
+    for (i = 0, sz = sizeof(a); i < sz; i++) {
+	if (a[i] != b[i]) {
+	    error(tag + ": element " + i);
+	}
+    }
+}
+
+/*
+ * called for runtime errors, which are reported if initialization fails
+ */
+static void runtime_error(string str, int caught, int ticks)
+{
+}
+
+static void initialize()
+{
+    object master;
+    mixed *a, *b;
+    int i, n;
+    string tag;
+
+    seed = 4711;
+    arrays = allocate(20);
+    for (i = 0; i < 20; i++) {
+	arrays[i] = ({ i });
+    }
+    master = compile_object("/obj");
+    objects = allocate(6);
+    for (i = 0; i < 6; i++) {
+	objects[i] = clone_object(master);
+    }
+
+    rlimits (0; -1) {
+	for (i = 0; i < 400; i++) {
+	    n = (rnd(2) != 0) ? 50 : 5000;
+	    a = random_array((rnd(4) != 0) ? rnd(70) : rnd(500), n);
+	    b = random_array((rnd(4) != 0) ? rnd(70) : rnd(500), n);
+	    if (i % 100 == 50) {
+		destruct_object(objects[i / 100]);
+	    }
+
+	    tag = "round " + i;
+	    compare(a - b, select(a, b, 0), tag + ", a - b");
+	    compare(a & b, select(a, b, 1), tag + ", a & b");
+	    compare(a | b, a + select(b, a, 0), tag + ", a | b");
+	    compare(a ^ b, select(a, b, 0) + select(b, a, 0), tag + ", a ^ b");
+	}
+    }
+    send_message("sets: ok\n");
+    shutdown();
+}
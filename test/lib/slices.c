@@ -0,0 +1,274 @@
+/*
+ * Driver object for slices.dgd: check that subranges of strings and
+ * arrays behave as copies.  Array subranges are changed at random, along
+ * with the arrays they come from, and compared against copies made one
+ * element at a time.  Some of them are kept across a swapout and a
+ * snapshot.
+ */
+
+# define NVIEWS		20
+
+mixed **views;			/* arrays and subranges under test */
+mixed **copies;			/* expected contents of each view */
+object *objects;		/* objects to use as elements */
+string failed;			/* error found after the first task */
+int seed;			/* random seed */
+
+/*
+ * reproducible random number in the range 0 .. n - 1
+ */
+static int rnd(int n)
+{
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return (seed >> 8) % n;
+}
+
+/*
+ * a random value
+ */
+static mixed value()
+{
+    int k;
+
+    k = rnd(1000);
+    switch (rnd(5)) {
+    case 0:
+	return k;
+
+    case 1:
+	return "str" + k;
+
+    case 2:
+	return ({ k });
+
+    case 3:
+	return objects[k % sizeof(objects)];
+
+    default:
+	return nil;
+    }
+}
+
+/*
+ * copy elements one at a time
+ */
+static mixed *copy(mixed *a, int from, int to)
+{
+    mixed *result;
+    int i;
+
+    result = allocate(to - from + 1);
+    for (i = from; i <= to; i++) {
+	result[i - from] = a[i];
+    }
+    return result;
+}
+
+/*
+ * check that every view has the expected contents
+ */
+static void check(string tag)
+{
+    int i, j, sz;
+
+    for (i = 0; i < NVIEWS; i++) {
+	if (views[i]) {
+	    if (sizeof(views[i]) != sizeof(copies[i])) {
+		error(tag + ": size of view " + i);
+	    }
+	    for (j = 0, sz = sizeof(views[i]); j < sz; j++) {
+		if (views[i][j] != copies[i][j]) {
+		    error(tag + ": element " + j + " of view " + i);
+		}
+	    }
+	}
+    }
+}
+
+/*
+ * assign random values to random views
+ */
+static void assign(int n)
+{
+    int i, j;
+
+    while (--n >= 0) {
+	i = rnd(NVIEWS);
+	if (views[i] && sizeof(views[i]) != 0) {
+	    j = rnd(sizeof(views[i]));
+	    views[i][j] = copies[i][j] = value();
+	}
+    }
+}
+
+/*
+ * assign, and then undo everything with an error
+ */
+static atomic void rollback()
+{
+    assign(20);
+    error("rollback");
+}
+
+/*
+ * random subranges, assignments and rollbacks
+ */
+static void arrays()
+{
+    int round, i, j, from, to;
+
+    views = allocate(NVIEWS);
+    copies = allocate(NVIEWS);
+    views[0] = allocate(500);
+    for (i = 0; i < 500; i++) {
+	views[0][i] = value();
+    }
+    copies[0] = copy(views[0], 0, 499);
+
+    for (round = 0; round < 2000; round++) {
+	i = rnd(NVIEWS);
+	j = rnd(NVIEWS);
+	switch (rnd(6)) {
+	case 0:
+	case 1:
+	    /* take a subrange of another view */
+	    if (views[j]) {
+		from = rnd(sizeof(views[j]) / 4 + 1);
+		to = sizeof(views[j]) - 1 - rnd(sizeof(views[j]) / 4 + 1);
+		views[i] = views[j][from .. to];
+		copies[i] = copy(copies[j], from, to);
+	    }
+	    break;
+
+	case 2:
+	    assign(5);
+	    break;
+
+	case 3:
+	    catch(rollback());
+	    break;
+
+	case 4:
+	    /* use the view in an operation */
+	    if (views[i] && sizeof(views[i]) != 0) {
+		views[j] = views[i] - ({ views[i][0] });
+		copies[j] = copies[i] - ({ copies[i][0] });
+	    }
+	    break;
+
+	default:
+	    if (i != 0) {
+		views[i] = copies[i] = nil;
+	    }
+	    break;
+	}
+
+	if (round % 250 == 0) {
+	    destruct_object(objects[round / 250]);
+	}
+	check("round " + round);
+    }
+}
+
+/*
+ * random subranges of a string, compared with a copy made of short pieces
+ */
+static void strings()
+{
+    string str, sub, piece;
+    int i, j, from, to;
+
+    str = "";
+    for (i = 0; i < 2000; i++) {
+	str += rnd(1000) + ((i % 7 != 0) ? " " : "\n");
+    }
+
+    for (i = 0; i < 500; i++) {
+	from = rnd(strlen(str) + 1);
+	to = from - 1 + rnd(strlen(str) - from + 1);
+	sub = str[from .. to];
+	if (rnd(2) != 0 && strlen(sub) != 0) {
+	    j = rnd(strlen(sub));
+	    sub = sub[j ..];
+	    from += j;
+	}
+
+	piece = "";
+	for (j = from; j <= to; j += 100) {
+	    piece += str[j .. (j + 99 < to) ? j + 99 : to];
+	}
+	if (sub != piece || strlen(sub) != to - from + 1 ||
+	    hash_crc32(sub) != hash_crc32(piece) ||
+	    sizeof(explode(sub, "\n")) != sizeof(explode(piece, "\n"))) {
+	    error("string " + from + ".." + to);
+	}
+	if (strlen(sub) != 0) {
+	    piece = sub;
+	    piece[0] = 'Q';
+	    if (sub[0] == 'Q' || str[from] == 'Q') {
+		error("string assignment " + from);
+	    }
+	}
+    }
+}
+
+/*
+ * called for runtime errors, which are reported if initialization or
+ * restoring fails
+ */
+static void runtime_error(string str, int caught, int ticks)
+{
+}
+
+/*
+ * called for errors in atomic code
+ */
+static void atomic_error(string str, int atom, int ticks)
+{
+}
+
+static void initialize()
+{
+    object master;
+    int i;
+
+    seed = 4711;
+    master = compile_object("/obj");
+    objects = allocate(10);
+    for (i = 0; i < 10; i++) {
+	objects[i] = clone_object(master);
+    }
+
+    rlimits (0; -1) {
+	strings();
+	arrays();
+    }
+    swapout();
+    call_out("swapped", 0);
+}
+
+/*
+ * the views were kept past the end of a task, and swapped out
+ */
+static void swapped()
+{
+    failed = catch(check("after swapout"), assign(50),
+		   check("after swapout"));
+    dump_state();
+    call_out("done", 0);
+}
+
+static void done()
+{
+    shutdown();
+}
+
+void restored()
+{
+    if (failed) {
+	error(failed);
+    }
+    check("after restore");
+    send_message("slices: ok\n");
+    shutdown();
+}
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# This file is part of DGD, https://github.com/dworkin/dgd
+# Copyright (C) 1993-2010 Dworkin B.V.
+# Copyright (C) 2010-2019 DGD Authors (see the commit log for details)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# usage: run.sh driver config
+#
+# Run the driver with one of the configuration files in this directory, in
+# a scratch copy of test/lib.  If the run creates a snapshot, the driver is
+# started once more to restore from it.
+#
+DRIVER=$1
+CONFIG=$2
+if [ ! -x "$DRIVER" ] || [ ! -f "$CONFIG" ]; then
+    echo "usage: $0 driver config" >&2
+    exit 2
+fi
+case $DRIVER in
+/*) ;;
+*)  DRIVER=`pwd`/$DRIVER ;;
+esac
+
+TMP=`mktemp -d` || exit 1
+trap 'rm -rf "$TMP"' 0
+cp -r `dirname "$0"`/lib "$TMP/lib" && mkdir "$TMP/state" || exit 1
+sed "s|@LIB@|$TMP/lib|" "$CONFIG" > "$TMP/config" || exit 1
+
+cd "$TMP/lib"
+"$DRIVER" "$TMP/config" || exit 1
+if [ -f "$TMP/state/snapshot" ]; then
+    "$DRIVER" "$TMP/config" "$TMP/state/snapshot" || exit 1
+fi